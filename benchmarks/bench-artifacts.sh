@@ -2,6 +2,18 @@
 #set -x	
 
 only_custom=false
+compare_aot=false
+compare_tiers=false
+bounds_guard_build=""
+lazy_baseline_build=""
+grow_guard_build=""
+natives_baseline_build=""
+compare_segue=false
+compare_simd=false
+compare_snapshot=false
+compare_fast_exit=false
+compare_pool=false
+compare_hugepages=false
 remove_artifacts_after_bench=false
 script_folder_name=$(basename "$(dirname "$(readlink -f "$0")")")/bench-artifacts
 mkdir -p $script_folder_name
@@ -15,6 +27,42 @@ for arg in "$@"; do
         only_custom=true
         break
     fi
+    if [ "$arg" == "--aot" ]; then
+        compare_aot=true
+    fi
+    if [ "$arg" == "--tiers" ]; then
+        compare_tiers=true
+    fi
+    if [ "$arg" == "--snapshot" ]; then
+        compare_snapshot=true
+    fi
+    if [ "$arg" == "--fast-exit" ]; then
+        compare_fast_exit=true
+    fi
+    if [ "$arg" == "--hugepages" ]; then
+        compare_hugepages=true
+    fi
+    if [ "$arg" == "--pool" ]; then
+        compare_pool=true
+    fi
+    if [ "$arg" == "--simd" ]; then
+        compare_simd=true
+    fi
+    if [ "$arg" == "--segue" ]; then
+        compare_segue=true
+    fi
+    if [[ "$arg" == --bounds=* ]]; then
+        bounds_guard_build="${arg#--bounds=}"
+    fi
+    if [[ "$arg" == --natives=* ]]; then
+        natives_baseline_build="${arg#--natives=}"
+    fi
+    if [[ "$arg" == --grow=* ]]; then
+        grow_guard_build="${arg#--grow=}"
+    fi
+    if [[ "$arg" == --lazy=* ]]; then
+        lazy_baseline_build="${arg#--lazy=}"
+    fi
 done
 
 run_hyperfine(){
@@ -30,6 +78,317 @@ run_hyperfine(){
         --command-name="bench of $1" "$2" 2> /dev/null
 }
 
+# runs two commands in the same hyperfine session so they are reported side by side
+# $1 example name, $2 first label, $3 first command, $4 second label, $5 second command
+run_hyperfine_compare(){
+    export_file="benchmarks/bench-artifacts/benchmark_$1_$2_vs_$4_$(date +%s%3N).json"
+    hyperfine \
+        --export-json="$export_file" \
+        -N \
+        --min-runs 10 \
+        --warmup=3 \
+        --time-unit=millisecond \
+        --input="${6:-/dev/null}" \
+        --command-name="$2 $1" "$3" \
+        --command-name="$4 $1" "$5" 2> /dev/null
+}
+
+# packs benchmarks/guests/$2 with the hermit.com found in build dir $1 as $3
+pack_guest(){
+    "$1/hermit.com" -f "benchmarks/guests/$2/Hermitfile" -o "$3" > /dev/null
+    chmod +x "$3"
+}
+
+# the HERMIT_HW_BOUND_CHECK build dir $1 was configured with, 0 unless set
+hw_bound_check(){
+    value=$(sed -n 's/^HERMIT_HW_BOUND_CHECK:[A-Z]*=//p' "$1/CMakeCache.txt" 2> /dev/null)
+    echo "${value:-0}"
+}
+
+# 16MiB of text for the count vowels throughput runs, path in $input_file
+make_vowels_input(){
+    input_file="$script_folder_name/vowels.txt"
+    if [ ! -f "$input_file" ]; then
+        yes eeeUIaoopaskjdfhiiioozzmmmwze | head -c 16777216 > "$input_file"
+    fi
+}
+
+# prints the throughput of each command of hyperfine export $1 over input $2
+report_throughput(){
+    if command -v jq > /dev/null; then
+        jq -r --argjson size "$(wc -c < "$2")" \
+            '.results[] | "\(.command): \($size / .mean / 1048576 | floor) MiB/s"' "$1"
+    fi
+}
+
+# prints p50, p90, p99 and max of each command of hyperfine export $1
+report_percentiles(){
+    if command -v jq > /dev/null; then
+        jq -r '.results[] | (.times | sort) as $t | ($t | length) as $n
+            | "\(.command): p50 \($t[($n * 0.5 | floor)] * 100000 | floor / 100) ms, p90 \($t[($n * 0.9 | floor)] * 100000 | floor / 100) ms, p99 \($t[($n * 0.99 | floor)] * 100000 | floor / 100) ms, max \($t[-1] * 100000 | floor / 100) ms"' "$1"
+    fi
+}
+
+# fails unless one in-process start of hermit $1 (with args $2...) ran its
+# main.aot, an image that doesn't load falls back to main.wasm silently
+check_aot_loaded(){
+    phases=$(build/hermit-bench.com -n 1 -w 0 "$@") || exit 1
+    if [[ "$phases" != *'"load_aot"'* || "$phases" == *'"load"'* ]]; then
+        echo "$1 didn't run its main.aot: $phases" >&2
+        exit 1
+    fi
+}
+
+# Check if --bounds=<build dir> was passed
+if [ "$only_custom" == false ] && [ -n "$bounds_guard_build" ]; then
+    # the other build is configured with -DHERMIT_HW_BOUND_CHECK=1
+    benchmarks/guests/build.sh memkernels
+    pack_guest build memkernels "$script_folder_name/memkernels.software.com"
+    pack_guest "$bounds_guard_build" memkernels "$script_folder_name/memkernels.guard.com"
+    for kernel in triad sieve histogram; do
+        run_hyperfine_compare "Memkernels_$kernel" "software-checks" "$script_folder_name/memkernels.software.com $kernel" "guard-pages" "$script_folder_name/memkernels.guard.com $kernel"
+    done
+    exit 0
+fi
+
+# Check if --natives=<build dir> was passed
+if [ "$only_custom" == false ] && [ -n "$natives_baseline_build" ]; then
+    # the baseline build is configured with -DHERMIT_LAZY_LIBC_BUILTIN=0 and
+    # registers every native module at startup, count_vowels only imports WASI
+    "$natives_baseline_build/hermit.com" -f src/count_vowels/Hermitfile -o "$script_folder_name/count_vowels.all-natives.com" > /dev/null
+    build/hermit.com -f src/count_vowels/Hermitfile -o "$script_folder_name/count_vowels.imported-natives.com" > /dev/null
+    chmod +x "$script_folder_name"/count_vowels.*-natives.com
+    run_hyperfine_compare "Count_vowels" "all-natives" "$script_folder_name/count_vowels.all-natives.com" "imported-natives" "$script_folder_name/count_vowels.imported-natives.com"
+    exit 0
+fi
+
+# Check if --grow=<build dir> was passed
+if [ "$only_custom" == false ] && [ -n "$grow_guard_build" ]; then
+    # build reallocates linear memory to grow it, the other build is
+    # configured with -DHERMIT_HW_BOUND_CHECK=1 and reserves it up front
+    benchmarks/guests/build.sh growpages
+    # with the same setting in both builds the comparison measures nothing
+    if [ "$(hw_bound_check build)" != 0 ] || [ "$(hw_bound_check "$grow_guard_build")" != 1 ]; then
+        echo "--grow needs build configured with -DHERMIT_HW_BOUND_CHECK=0 and $grow_guard_build with -DHERMIT_HW_BOUND_CHECK=1" >&2
+        exit 1
+    fi
+    pack_guest build growpages "$script_folder_name/growpages.realloc.com"
+    pack_guest "$grow_guard_build" growpages "$script_folder_name/growpages.reserved.com"
+    echo "realloc: build, HERMIT_HW_BOUND_CHECK=0"
+    "$script_folder_name/growpages.realloc.com" "${GROW_MIB:-4096}"
+    echo "reserved: $grow_guard_build, HERMIT_HW_BOUND_CHECK=1"
+    "$script_folder_name/growpages.reserved.com" "${GROW_MIB:-4096}"
+    run_hyperfine_compare "Growpages" "realloc" "$script_folder_name/growpages.realloc.com ${GROW_MIB:-4096}" "reserved" "$script_folder_name/growpages.reserved.com ${GROW_MIB:-4096}"
+    exit 0
+fi
+
+# Check if --lazy=<build dir> was passed
+if [ "$only_custom" == false ] && [ -n "$lazy_baseline_build" ]; then
+    # the baseline build is configured with -DWAMR_BUILD_LAZY_JIT=0, so it
+    # compiles the whole ~50MB module before main. Building the guest takes
+    # a few minutes, it is only rebuilt when missing
+    if [ ! -f benchmarks/guests/bigmodule/main.wasm ]; then
+        benchmarks/guests/build.sh bigmodule
+    fi
+    pack_guest "$lazy_baseline_build" bigmodule "$script_folder_name/bigmodule.eager.com"
+    pack_guest build bigmodule "$script_folder_name/bigmodule.lazy.com"
+    # one call is pure startup, 1000 calls touch about 1% of the functions
+    for calls in 1 1000; do
+        run_hyperfine_compare "Bigmodule_$calls" "eager" "$script_folder_name/bigmodule.eager.com $calls" "lazy" "$script_folder_name/bigmodule.lazy.com $calls"
+    done
+    exit 0
+fi
+
+# Check if --segue was passed
+if [ "$only_custom" == false ] && [ "$compare_segue" == true ]; then
+    benchmarks/guests/build.sh pointerchase
+    guest_wasm=benchmarks/guests/pointerchase/main.wasm
+    wamrc --target=x86_64 -o "$script_folder_name/pointerchase.aot" "$guest_wasm"
+    wamrc --target=x86_64 --enable-segue -o "$script_folder_name/pointerchase.segue.aot" "$guest_wasm"
+    build/hermit.com -f benchmarks/guests/pointerchase/Hermitfile -o "$script_folder_name/pointerchase.plain.com" \
+        --aot "$script_folder_name/pointerchase.aot" > /dev/null
+    build/hermit.com -f benchmarks/guests/pointerchase/Hermitfile -o "$script_folder_name/pointerchase.segue.com" \
+        --aot "$script_folder_name/pointerchase.segue.aot" --aot-segue > /dev/null
+    chmod +x "$script_folder_name"/pointerchase.*.com
+    for kernel in chase memcpy; do
+        run_hyperfine_compare "Pointerchase_$kernel" "plain" "$script_folder_name/pointerchase.plain.com $kernel" "segue" "$script_folder_name/pointerchase.segue.com $kernel"
+    done
+    exit 0
+fi
+
+# Check if --snapshot was passed
+if [ "$only_custom" == false ] && [ "$compare_snapshot" == true ]; then
+    benchmarks/guests/build.sh inittables
+    pack_guest build inittables "$script_folder_name/inittables.com"
+    HERMIT=build/hermit.com ./snapshot_hermit.sh -f benchmarks/guests/inittables/Hermitfile -o "$script_folder_name/inittables.snapshot.com"
+    run_hyperfine_compare "Inittables" "init" "$script_folder_name/inittables.com 7 65537" "snapshot" "$script_folder_name/inittables.snapshot.com 7 65537"
+    exit 0
+fi
+
+# Check if --fast-exit was passed
+if [ "$only_custom" == false ] && [ "$compare_fast_exit" == true ]; then
+    benchmarks/guests/build.sh growmem
+    pack_guest build growmem "$script_folder_name/growmem.com"
+    # enough runs for the tail to mean something
+    export_file="$script_folder_name/benchmark_fast_exit_$(date +%s%3N).json"
+    hyperfine \
+        --export-json="$export_file" \
+        -N \
+        --min-runs 100 \
+        --warmup=3 \
+        --time-unit=millisecond \
+        --command-name="teardown growmem" "env HERMIT_FAST_EXIT=0 $script_folder_name/growmem.com" \
+        --command-name="fast-exit growmem" "env HERMIT_FAST_EXIT=1 $script_folder_name/growmem.com" 2> /dev/null
+    report_percentiles "$export_file"
+    exit 0
+fi
+
+# Check if --hugepages was passed
+if [ "$only_custom" == false ] && [ "$compare_hugepages" == true ]; then
+    benchmarks/guests/build.sh randaccess
+    pack_guest build randaccess "$script_folder_name/randaccess.com"
+    run_hyperfine_compare "Randaccess" "4k-pages" "env HERMIT_HUGEPAGES=0 $script_folder_name/randaccess.com" "huge-pages" "env HERMIT_HUGEPAGES=1 $script_folder_name/randaccess.com"
+    # the dTLB misses behind the difference, needs perf and access to the
+    # counters (kernel.perf_event_paranoid)
+    if command -v perf > /dev/null; then
+        for hugepages in 0 1; do
+            HERMIT_HUGEPAGES=$hugepages perf stat -e dTLB-loads,dTLB-load-misses,dTLB-stores,dTLB-store-misses \
+                "$script_folder_name/randaccess.com" > /dev/null
+        done
+    fi
+    exit 0
+fi
+
+# Check if --pool was passed
+if [ "$only_custom" == false ] && [ "$compare_pool" == true ]; then
+    make_vowels_input
+    # the runtime's own allocations, and linear memory unless the build uses
+    # guard page bounds checks
+    pool_size="${HERMIT_BENCH_POOL_SIZE:-64M}"
+    workloads=("cat|build/cat.hermit.com src/cat/cat.c|/dev/null"
+        "cowsay|build/cowsay.hermit.com Hermooooooooot|/dev/null"
+        "count_vowels|build/count_vowels.hermit.com|$input_file")
+    for workload in "${workloads[@]}"; do
+        IFS="|" read -r name cmd input <<< "$workload"
+        export_file="$script_folder_name/benchmark_pool_${name}_$(date +%s%3N).json"
+        hyperfine \
+            --export-json="$export_file" \
+            -N \
+            --min-runs 50 \
+            --warmup=3 \
+            --input="$input" \
+            --time-unit=millisecond \
+            --command-name="malloc $name" "env HERMIT_HEAP_POOL=0 $cmd" \
+            --command-name="pool $name" "env HERMIT_HEAP_POOL=$pool_size $cmd" 2> /dev/null
+        report_percentiles "$export_file"
+    done
+    exit 0
+fi
+
+# Check if --simd was passed
+if [ "$only_custom" == false ] && [ "$compare_simd" == true ]; then
+    make_vowels_input
+    guest_wasm=benchmarks/guests/count_vowels/main.wasm
+    simd_cmds=()
+    # HERMIT_RUNTIME=llvm-jit fails outright in builds without LLVM
+    has_llvm_jit=false
+    if grep -q '^LLVM_DIR:' build/CMakeCache.txt 2> /dev/null; then
+        has_llvm_jit=true
+    else
+        echo "build has no LLVM JIT, configure it with LLVM_DIR to compare on it" >&2
+    fi
+    for variant in scalar simd; do
+        if [ "$variant" == simd ]; then
+            GUEST_CFLAGS=-msimd128 benchmarks/guests/build.sh count_vowels
+        else
+            GUEST_CFLAGS= benchmarks/guests/build.sh count_vowels
+        fi
+        # SIMD can't run on the interpreters or Fast JIT, compare both
+        # variants on the LLVM JIT and, with wamrc, AOT compiled
+        if [ "$has_llvm_jit" == true ]; then
+            pack_guest build count_vowels "$script_folder_name/count_vowels.$variant.com"
+            simd_cmds+=(--command-name="$variant llvm-jit" "env HERMIT_RUNTIME=llvm-jit $script_folder_name/count_vowels.$variant.com")
+        fi
+        if command -v wamrc > /dev/null; then
+            wamrc --target=x86_64 -o "$script_folder_name/count_vowels.$variant.aot" "$guest_wasm" > /dev/null
+            build/hermit.com -f benchmarks/guests/count_vowels/Hermitfile -o "$script_folder_name/count_vowels.$variant.aot.com" \
+                --aot "$script_folder_name/count_vowels.$variant.aot" > /dev/null
+            chmod +x "$script_folder_name/count_vowels.$variant.aot.com"
+            simd_cmds+=(--command-name="$variant aot" "$script_folder_name/count_vowels.$variant.aot.com")
+        fi
+    done
+    if [ ${#simd_cmds[@]} -eq 0 ]; then
+        echo "neither an LLVM JIT nor wamrc is available, skipping --simd" >&2
+        exit 0
+    fi
+    export_file="$script_folder_name/benchmark_simd_$(date +%s%3N).json"
+    hyperfine \
+        --export-json="$export_file" \
+        -N \
+        --min-runs 5 \
+        --warmup=1 \
+        --input="$input_file" \
+        --time-unit=millisecond \
+        "${simd_cmds[@]}"
+    report_throughput "$export_file" "$input_file"
+    exit 0
+fi
+
+# Check if --aot was passed
+if [ "$only_custom" == false ] && [ "$compare_aot" == true ]; then
+    # the *.aot.hermit.com examples are only built when wamrc is in PATH
+    if [ ! -f build/cat.aot.hermit.com ]; then
+        echo "build/*.aot.hermit.com not found, install wamrc and rebuild" >&2
+        exit 1
+    fi
+    # the same hermit on the interpreter, not the default Fast JIT, and AOT
+    # compiled. hyperfine -N runs no shell, so count_vowels reads a file
+    vowels_short="$script_folder_name/vowels_short.txt"
+    echo eeeUIaoopaskjdfhiiioozzmmmwze > "$vowels_short"
+    check_aot_loaded build/cat.aot.hermit.com src/cat/cat.c
+    check_aot_loaded build/count_vowels.aot.hermit.com
+    check_aot_loaded build/cowsay.aot.hermit.com Hermooooooooot
+    run_hyperfine_compare "Cat" "interp" "env HERMIT_RUNTIME=interp build/cat.hermit.com src/cat/cat.c" "aot" "build/cat.aot.hermit.com src/cat/cat.c"
+    run_hyperfine_compare "Count_vowels" "interp" "env HERMIT_RUNTIME=interp build/count_vowels.hermit.com" "aot" "build/count_vowels.aot.hermit.com" "$vowels_short"
+    run_hyperfine_compare "Cowsay" "interp" "env HERMIT_RUNTIME=interp build/cowsay.hermit.com Hermooooooooot" "aot" "build/cowsay.aot.hermit.com Hermooooooooot"
+    exit 0
+fi
+
+# Check if --tiers was passed
+if [ "$only_custom" == false ] && [ "$compare_tiers" == true ]; then
+    runtimes=("interp" "fast-jit" "llvm-jit" "multi-tier")
+    # time to first output: a short run is dominated by startup and compilation
+    short_cmds=()
+    for runtime in "${runtimes[@]}"; do
+        short_cmds+=(--command-name="$runtime" "env HERMIT_RUNTIME=$runtime build/cowsay.hermit.com Hermooooooooot")
+    done
+    hyperfine \
+        --export-json="$script_folder_name/benchmark_tiers_short_$(date +%s%3N).json" \
+        -N \
+        --min-runs 10 \
+        --warmup=3 \
+        --time-unit=millisecond \
+        "${short_cmds[@]}"
+
+    # steady state: count vowels over a large input, reported in MiB/s
+    make_vowels_input
+    long_cmds=()
+    for runtime in "${runtimes[@]}"; do
+        long_cmds+=(--command-name="$runtime" "env HERMIT_RUNTIME=$runtime build/count_vowels.hermit.com")
+    done
+    export_file="$script_folder_name/benchmark_tiers_long_$(date +%s%3N).json"
+    hyperfine \
+        --export-json="$export_file" \
+        -N \
+        --min-runs 5 \
+        --warmup=1 \
+        --input="$input_file" \
+        --time-unit=millisecond \
+        "${long_cmds[@]}"
+    report_throughput "$export_file" "$input_file"
+    exit 0
+fi
+
 # Check if --only-custom was passed
 if [ "$only_custom" == false ]; then
     # Benchmark build/cat.hermit.com, build/count_vowels.hermit.com and  build/cowsay.hermit.com examples.
@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A module of 100000 distinct functions, around 50MB of Wasm, of which a run
+// calls only a handful. Stands in for large programs like src/ubuntu, where
+// startup cost should follow the code that runs rather than module size.
+// usage: bigmodule [calls]
+
+#define STEP(n, k)                                                             \
+  x = (x ^ (x >> ((k) % 29 + 1))) *                                            \
+      ((uint32_t)(n) * 2654435761u + (k) * 40503u + 1u);
+#define STEPS8(n, k)                                                           \
+  STEP(n, k) STEP(n, k + 1) STEP(n, k + 2) STEP(n, k + 3) STEP(n, k + 4)       \
+      STEP(n, k + 5) STEP(n, k + 6) STEP(n, k + 7)
+
+#define FUNC(n)                                                                \
+  __attribute__((noinline)) static uint32_t f##n(uint32_t x) {                 \
+    STEPS8(1##n, 0) STEPS8(1##n, 8) STEPS8(1##n, 16) STEPS8(1##n, 24)          \
+    STEPS8(1##n, 32) STEPS8(1##n, 40)                                          \
+    return x;                                                                  \
+  }
+#define ENTRY(n) f##n,
+
+#define X1(M, p)                                                               \
+  M(p##0) M(p##1)                                                              \
+  M(p##2) M(p##3)                                                              \
+  M(p##4) M(p##5)                                                              \
+  M(p##6) M(p##7)                                                              \
+  M(p##8) M(p##9)
+#define X2(M, p)                                                               \
+  X1(M, p##0) X1(M, p##1)                                                      \
+  X1(M, p##2) X1(M, p##3)                                                      \
+  X1(M, p##4) X1(M, p##5)                                                      \
+  X1(M, p##6) X1(M, p##7)                                                      \
+  X1(M, p##8) X1(M, p##9)
+#define X3(M, p)                                                               \
+  X2(M, p##0) X2(M, p##1)                                                      \
+  X2(M, p##2) X2(M, p##3)                                                      \
+  X2(M, p##4) X2(M, p##5)                                                      \
+  X2(M, p##6) X2(M, p##7)                                                      \
+  X2(M, p##8) X2(M, p##9)
+#define X4(M, p)                                                               \
+  X3(M, p##0) X3(M, p##1)                                                      \
+  X3(M, p##2) X3(M, p##3)                                                      \
+  X3(M, p##4) X3(M, p##5)                                                      \
+  X3(M, p##6) X3(M, p##7)                                                      \
+  X3(M, p##8) X3(M, p##9)
+#define X5(M)                                                                  \
+  X4(M, 0) X4(M, 1)                                                            \
+  X4(M, 2) X4(M, 3)                                                            \
+  X4(M, 4) X4(M, 5)                                                            \
+  X4(M, 6) X4(M, 7)                                                            \
+  X4(M, 8) X4(M, 9)
+
+X5(FUNC)
+
+static uint32_t (*const funcs[])(uint32_t) = {X5(ENTRY)};
+
+int main(int argc, char *argv[]) {
+  const uint32_t nfuncs = sizeof(funcs) / sizeof(funcs[0]);
+  uint32_t calls = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 1;
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < calls; i++) {
+    x = funcs[(x ^ i) % nfuncs](x);
+  }
+  printf("%u\n", x);
+  return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/bash
+# Builds benchmarks/guests/<name>/<name>.c into benchmarks/guests/<name>/main.wasm
+# with wasi-sdk, see https://github.com/WebAssembly/wasi-sdk
+# usage: benchmarks/guests/build.sh [names...]
+set -e
+
+guests_folder=$(dirname "$(readlink -f "$0")")
+wasi_sdk_path=${WASI_SDK_PATH:-/opt/wasi-sdk}
+cc="$wasi_sdk_path/bin/clang"
+if [ ! -x "$cc" ]; then
+    echo "$cc not found, set WASI_SDK_PATH to your wasi-sdk install" >&2
+    exit 1
+fi
+
+names=("$@")
+if [ ${#names[@]} -eq 0 ]; then
+    names=($(ls -d "$guests_folder"/*/ | xargs -n 1 basename))
+fi
+for name in "${names[@]}"; do
+    guest_folder="$guests_folder/$name"
+    "$cc" -O2 $GUEST_CFLAGS -o "$guest_folder/main.wasm" "$guest_folder/$name.c"
+done
@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A short-lived run that grows linear memory to about 1GB, touches all of it
+// and exits, so the cost of tearing the runtime down shows in its latency.
+// usage: growmem [MiB]
+
+#define CHUNK (16 << 20)
+
+int main(int argc, char *argv[]) {
+  uint32_t mib = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 1024 - 16;
+  uint32_t chunks = mib / (CHUNK >> 20);
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < chunks; i++) {
+    uint8_t *p = malloc(CHUNK);
+    if (!p) {
+      fprintf(stderr, "out of memory after %u MiB\n", i * (CHUNK >> 20));
+      return 1;
+    }
+    memset(p, (int)i, CHUNK);
+    sum += p[i % CHUNK];
+  }
+  printf("%llu\n", (unsigned long long)sum);
+  return 0;
+}
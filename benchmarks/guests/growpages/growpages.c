@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Grows linear memory one 64KiB page at a time, writing to each new page,
+// the way a guest that keeps appending to its heap does. Every memory.grow
+// is timed, a runtime that moves linear memory to grow it copies everything
+// so far and the slowest calls show it.
+// usage: growpages [MiB]
+
+#define PAGE_SIZE 65536
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t mib = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 4096;
+  uint64_t target = (uint64_t)mib * (1 << 20) / PAGE_SIZE;
+  uint64_t slowest_ns = 0;
+  uint64_t total_ns = 0;
+  uint32_t grows = 0;
+  while (__builtin_wasm_memory_size(0) < target) {
+    uint64_t start = now_ns();
+    size_t page = __builtin_wasm_memory_grow(0, 1);
+    uint64_t ns = now_ns() - start;
+    if (page == (size_t)-1) {
+      fprintf(stderr, "memory.grow failed at %zu pages\n", __builtin_wasm_memory_size(0));
+      return 1;
+    }
+    *(volatile uint8_t *)(page * PAGE_SIZE) = 1;
+    total_ns += ns;
+    slowest_ns = ns > slowest_ns ? ns : slowest_ns;
+    grows++;
+  }
+  printf("%u grows to %zu pages, mean %.2fus, slowest %.2fus\n", grows, __builtin_wasm_memory_size(0),
+         grows ? total_ns / 1e3 / grows : 0.0, slowest_ns / 1e3);
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Spends most of a run building lookup tables, like guests that parse
+// embedded data or run heavy static constructors. The `init` export is the
+// Hermitfile's SNAPSHOT, so snapshotted hermits start with the tables built.
+// usage: inittables [numbers...]
+
+#define SIEVE_LEN (1 << 23)
+#define WORDS (1 << 16)
+#define BUCKETS (1 << 17)
+
+static int initialized;
+static uint8_t composite[SIEVE_LEN];
+static char *words[WORDS];
+static uint32_t buckets[BUCKETS];
+
+static uint32_t hash(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  }
+  return h;
+}
+
+__attribute__((export_name("init"))) void init(void) {
+  for (uint32_t i = 2; i * i < SIEVE_LEN; i++) {
+    if (!composite[i]) {
+      for (uint32_t j = i * i; j < SIEVE_LEN; j += i) {
+        composite[j] = 1;
+      }
+    }
+  }
+  // heap allocated on purpose, the snapshot keeps malloc's state too
+  for (uint32_t i = 0; i < WORDS; i++) {
+    char word[16];
+    snprintf(word, sizeof(word), "w%u", i * 2654435761u);
+    words[i] = strdup(word);
+    uint32_t b = hash(word) & (BUCKETS - 1);
+    while (buckets[b]) {
+      b = (b + 1) & (BUCKETS - 1);
+    }
+    buckets[b] = i + 1;
+  }
+  initialized = 1;
+}
+
+int main(int argc, char *argv[]) {
+  if (!initialized) {
+    init();
+  }
+  for (int i = 1; i < argc; i++) {
+    const uint32_t n = strtoul(argv[i], NULL, 10);
+    const uint32_t word = n % WORDS;
+    uint32_t b = hash(words[word]) & (BUCKETS - 1);
+    while (buckets[b] != word + 1) {
+      b = (b + 1) & (BUCKETS - 1);
+    }
+    printf("%u: %s, word %s in bucket %u\n", n,
+           n < SIEVE_LEN && n > 1 && !composite[n] ? "prime" : "not prime",
+           words[word], b);
+  }
+  return 0;
+}
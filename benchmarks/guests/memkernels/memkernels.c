@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Memory-heavy kernels where the cost of linear memory bounds checks shows.
+// usage: memkernels <triad|sieve|histogram> [iterations]
+
+#define TRIAD_LEN (1 << 20)
+#define SIEVE_LEN (1 << 24)
+#define HISTOGRAM_LEN (1 << 24)
+
+static double triad(int iterations) {
+  double *a = malloc(TRIAD_LEN * sizeof(double));
+  double *b = malloc(TRIAD_LEN * sizeof(double));
+  double *c = malloc(TRIAD_LEN * sizeof(double));
+  if (!a || !b || !c) {
+    return -1;
+  }
+  for (size_t i = 0; i < TRIAD_LEN; i++) {
+    b[i] = i;
+    c[i] = TRIAD_LEN - i;
+  }
+  for (int n = 0; n < iterations; n++) {
+    for (size_t i = 0; i < TRIAD_LEN; i++) {
+      a[i] = b[i] + 3.0 * c[i];
+    }
+    double *t = b;
+    b = a;
+    a = t;
+  }
+  const double sum = a[TRIAD_LEN / 2] + b[TRIAD_LEN / 3];
+  free(a);
+  free(b);
+  free(c);
+  return sum;
+}
+
+static double sieve(int iterations) {
+  uint8_t *composite = malloc(SIEVE_LEN);
+  if (!composite) {
+    return -1;
+  }
+  size_t primes = 0;
+  for (int n = 0; n < iterations; n++) {
+    memset(composite, 0, SIEVE_LEN);
+    primes = 0;
+    for (size_t i = 2; i < SIEVE_LEN; i++) {
+      if (composite[i]) {
+        continue;
+      }
+      primes++;
+      for (size_t j = i * i; j < SIEVE_LEN; j += i) {
+        composite[j] = 1;
+      }
+    }
+  }
+  free(composite);
+  return primes;
+}
+
+static double histogram(int iterations) {
+  uint32_t *counts = calloc(HISTOGRAM_LEN, sizeof(uint32_t));
+  if (!counts) {
+    return -1;
+  }
+  // xorshift, scattered loads and stores over 64MiB
+  uint32_t x = 2463534242u;
+  for (int n = 0; n < iterations; n++) {
+    for (size_t i = 0; i < HISTOGRAM_LEN; i++) {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      counts[x & (HISTOGRAM_LEN - 1)]++;
+    }
+  }
+  const double sample = counts[0] + counts[HISTOGRAM_LEN - 1];
+  free(counts);
+  return sample;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <triad|sieve|histogram> [iterations]\n",
+            argv[0]);
+    return 1;
+  }
+  const int iterations = argc > 2 ? atoi(argv[2]) : 10;
+  double result;
+  if (strcmp(argv[1], "triad") == 0) {
+    result = triad(iterations);
+  } else if (strcmp(argv[1], "sieve") == 0) {
+    result = sieve(iterations);
+  } else if (strcmp(argv[1], "histogram") == 0) {
+    result = histogram(iterations);
+  } else {
+    fprintf(stderr, "%s: unknown kernel %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  printf("%s: %.0f\n", argv[1], result);
+  return result < 0;
+}
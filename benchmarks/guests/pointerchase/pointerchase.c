@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Load/store heavy kernels where linear memory addressing dominates.
+// usage: pointerchase <chase|memcpy> [iterations]
+
+#define NODES (1 << 22)
+#define COPY_LEN (1 << 24)
+
+static uint64_t chase(int iterations) {
+  uint32_t *next = malloc(NODES * sizeof(uint32_t));
+  if (!next) {
+    return 0;
+  }
+  // Sattolo's shuffle, a single cycle through all nodes
+  for (uint32_t i = 0; i < NODES; i++) {
+    next[i] = i;
+  }
+  uint32_t x = 88172645u;
+  for (uint32_t i = NODES - 1; i > 0; i--) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    const uint32_t j = x % i;
+    const uint32_t t = next[i];
+    next[i] = next[j];
+    next[j] = t;
+  }
+  uint64_t sum = 0;
+  uint32_t node = 0;
+  for (int n = 0; n < iterations; n++) {
+    for (uint32_t i = 0; i < NODES; i++) {
+      node = next[node];
+      sum += node;
+    }
+  }
+  free(next);
+  return sum;
+}
+
+static uint64_t copy(int iterations) {
+  uint8_t *a = malloc(COPY_LEN);
+  uint8_t *b = malloc(COPY_LEN);
+  if (!a || !b) {
+    return 0;
+  }
+  for (size_t i = 0; i < COPY_LEN; i++) {
+    a[i] = i;
+  }
+  for (int n = 0; n < iterations; n++) {
+    memcpy(b, a, COPY_LEN);
+    memcpy(a + 1, b, COPY_LEN - 1);
+  }
+  const uint64_t sample = a[COPY_LEN - 1] + b[COPY_LEN / 2];
+  free(a);
+  free(b);
+  return sample;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <chase|memcpy> [iterations]\n", argv[0]);
+    return 1;
+  }
+  const int iterations = argc > 2 ? atoi(argv[2]) : 10;
+  uint64_t result;
+  if (strcmp(argv[1], "chase") == 0) {
+    result = chase(iterations);
+  } else if (strcmp(argv[1], "memcpy") == 0) {
+    result = copy(iterations);
+  } else {
+    fprintf(stderr, "%s: unknown kernel %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  printf("%s: %llu\n", argv[1], (unsigned long long)result);
+  return 0;
+}
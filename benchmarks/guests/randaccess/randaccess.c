@@ -0,0 +1,34 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Random reads and writes over a large buffer, nearly every access lands on
+// a different page, so with 4KB pages most of them miss the dTLB.
+// usage: randaccess [MiB] [millions of accesses]
+
+int main(int argc, char *argv[]) {
+  uint32_t mib = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 1024;
+  uint32_t accesses = (argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 20) * 1000000;
+  uint32_t words = mib * (1 << 20) / sizeof(uint32_t);
+  uint32_t *buf = malloc((size_t)words * sizeof(uint32_t));
+  if (!buf || words == 0) {
+    fprintf(stderr, "can't allocate %u MiB\n", mib);
+    return 1;
+  }
+  for (uint32_t i = 0; i < words; i++) {
+    buf[i] = i;
+  }
+  // xorshift32, the index depends on the last load so accesses don't overlap
+  uint32_t x = 2463534242u;
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < accesses; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    uint32_t index = (x ^ sum) % words;
+    sum += buf[index];
+    buf[index] = sum;
+  }
+  printf("%u\n", sum);
+  return 0;
+}
@@ -0,0 +1,119 @@
+// hermit.cfg, the flat binary form of hermit.json that hermit-base uses in
+// place from the executable. The layout is `hermit_config_blob` in
+// src/hermit-config.c: a header of little endian u32s, then the MAP, ENV and
+// IMPORT_MODULES arrays of string offsets, then NUL terminated strings.
+// Offsets are from the start of the blob.
+
+use crate::{Hermitfile, RUNTIMES};
+
+const MAGIC: &[u8; 4] = b"HCFG";
+const VERSION: u32 = 4;
+const HEADER_SIZE: usize = 21 * 4;
+
+const ENV_PWD_IS_HOST_CWD: u32 = 1 << 0;
+const ENV_EXE_NAME_IS_HOST_EXE_NAME: u32 = 1 << 1;
+const CACHE: u32 = 1 << 2;
+const TRUSTED: u32 = 1 << 3;
+const AOT_SEGUE: u32 = 1 << 4;
+const SIMD: u32 = 1 << 5;
+const PGO_TRAIN: u32 = 1 << 6;
+const FAST_EXIT: u32 = 1 << 7;
+const HUGEPAGES: u32 = 1 << 8;
+// IMPORT_MODULES is the complete list, even when it is empty
+const IMPORT_MODULES_KNOWN: u32 = 1 << 9;
+
+struct Strings {
+    base: usize,
+    bytes: Vec<u8>,
+}
+
+impl Strings {
+    fn add(&mut self, s: &str) -> u32 {
+        if s.contains('\0') {
+            panic!("{s:?} can't be stored in hermit.cfg");
+        }
+        let offset = self.base + self.bytes.len();
+        self.bytes.extend_from_slice(s.as_bytes());
+        self.bytes.push(0);
+        offset as u32
+    }
+
+    // 0 marks an unset string
+    fn add_optional(&mut self, s: &str) -> u32 {
+        if s.is_empty() {
+            0
+        } else {
+            self.add(s)
+        }
+    }
+}
+
+pub fn encode(hermit: &Hermitfile) -> Vec<u8> {
+    let import_modules = hermit.import_modules.as_deref().unwrap_or_default();
+    let map_offset = HEADER_SIZE;
+    let env_offset = map_offset + 4 * hermit.map.len();
+    let imports_offset = env_offset + 4 * hermit.env.len();
+    let mut strings = Strings {
+        base: imports_offset + 4 * import_modules.len(),
+        bytes: Vec::new(),
+    };
+    let map: Vec<u32> = hermit.map.iter().map(|s| strings.add(s)).collect();
+    let env: Vec<u32> = hermit.env.iter().map(|s| strings.add(s)).collect();
+    let imports: Vec<u32> = import_modules.iter().map(|s| strings.add(s)).collect();
+    let entrypoint = strings.add_optional(&hermit.entrypoint);
+    let snapshot = strings.add_optional(&hermit.snapshot);
+    let wasm_sha256 = strings.add_optional(&hermit.wasm_sha256);
+
+    let flags = [
+        (hermit.uses_host_cwd, ENV_PWD_IS_HOST_CWD),
+        (hermit.uses_host_exe_name, ENV_EXE_NAME_IS_HOST_EXE_NAME),
+        (hermit.cache, CACHE),
+        (hermit.trusted, TRUSTED),
+        (hermit.aot_segue, AOT_SEGUE),
+        (hermit.simd, SIMD),
+        (hermit.pgo_train, PGO_TRAIN),
+        (hermit.fast_exit, FAST_EXIT),
+        (hermit.hugepages, HUGEPAGES),
+        (hermit.import_modules.is_some(), IMPORT_MODULES_KNOWN),
+    ]
+    .iter()
+    .filter(|(set, _)| *set)
+    .fold(0, |flags, (_, flag)| flags | flag);
+    // hermit_runtime in src/wamr.h, 0 is WAMR's default
+    let runtime = RUNTIMES
+        .iter()
+        .position(|&r| r == hermit.runtime)
+        .map_or(0, |i| i as u32 + 1);
+
+    let size = strings.base + strings.bytes.len();
+    let header = [
+        VERSION,
+        size as u32,
+        flags,
+        runtime,
+        hermit.jit_code_cache_size.unwrap_or(0),
+        hermit.llvm_jit_opt_level.unwrap_or(0),
+        hermit.llvm_jit_size_level.unwrap_or(0),
+        map.len() as u32,
+        map_offset as u32,
+        env.len() as u32,
+        env_offset as u32,
+        entrypoint,
+        snapshot,
+        wasm_sha256,
+        imports.len() as u32,
+        imports_offset as u32,
+        hermit.stack_size.unwrap_or(0),
+        hermit.heap_size.unwrap_or(0),
+        hermit.max_memory_pages.unwrap_or(0),
+        hermit.heap_pool_size.unwrap_or(0),
+    ];
+    let mut blob = Vec::with_capacity(size);
+    blob.extend_from_slice(MAGIC);
+    for value in header.iter().chain(&map).chain(&env).chain(&imports) {
+        blob.extend_from_slice(&value.to_le_bytes());
+    }
+    blob.extend_from_slice(&strings.bytes);
+    assert_eq!(blob.len(), size);
+    blob
+}
@@ -0,0 +1,63 @@
+// hermit-base flavors, builds with fewer WAMR features than the full one
+// hermit.com itself runs on. They are carried in hermit.com's zip as
+// `flavors/<name>.com` and the packer puts the smallest one that can run a
+// hermit in front of it, see HERMIT_FLAVORS in CMakeLists.txt.
+
+use crate::Hermitfile;
+
+pub const ENTRY_PREFIX: &str = "flavors/";
+
+/// The base hermit.com was packed onto, it runs every hermit
+pub const FULL: &str = "full";
+
+struct Flavor {
+    name: &'static str,
+    // explicit `RUNTIME`s it has the running mode for
+    runtimes: &'static [&'static str],
+    // has the AOT loader, which also runs SIMD and PGO instrumented images
+    aot: bool,
+    // has the LLVM JIT, which SIMD in the Wasm needs
+    simd_wasm: bool,
+}
+
+const FLAVORS: [Flavor; 2] = [
+    Flavor {
+        name: "interp",
+        runtimes: &["interp"],
+        aot: false,
+        simd_wasm: false,
+    },
+    Flavor {
+        name: "aot",
+        runtimes: &["interp"],
+        aot: true,
+        simd_wasm: false,
+    },
+];
+
+pub fn is_known(name: &str) -> bool {
+    name == FULL || FLAVORS.iter().any(|f| f.name == name)
+}
+
+/// Returns true if the flavor can run the hermit as the full base would
+pub fn satisfies(name: &str, hermit: &Hermitfile, has_aot: bool) -> bool {
+    let flavor = match FLAVORS.iter().find(|f| f.name == name) {
+        Some(flavor) => flavor,
+        None => return name == FULL,
+    };
+    if (has_aot || hermit.pgo_train) && !flavor.aot {
+        return false;
+    }
+    // SIMD in the Wasm needs the LLVM JIT, also with an AOT image, whose
+    // fallback is the Wasm, and the cache compiles with it
+    if (hermit.simd && !flavor.simd_wasm) || hermit.cache {
+        return false;
+    }
+    if hermit.runtime.is_empty() {
+        // without a RUNTIME the full base runs the Wasm on Fast JIT, only
+        // hand that to an interpreter when it is just the AOT fallback
+        has_aot
+    } else {
+        flavor.runtimes.contains(&hermit.runtime.as_str())
+    }
+}
@@ -4,10 +4,15 @@ use std::io::SeekFrom;
 use clap;
 use dockerfile_parser::{Dockerfile, Instruction};
 use serde::Serialize;
+use sha2::{Digest, Sha256};
 use std::io::Read;
 use std::io::Seek;
 use std::io::Write;
 
+mod config;
+mod flavor;
+mod wasm;
+
 #[derive(Debug, Default, Serialize)]
 struct Hermitfile {
     // supported:
@@ -23,6 +28,67 @@ struct Hermitfile {
     #[serde(rename = "ENV_EXE_NAME_IS_HOST_EXE_NAME")]
     #[serde(skip_serializing_if = "std::ops::Not::not")]
     pub uses_host_exe_name: bool,
+    #[serde(rename = "RUNTIME")]
+    #[serde(skip_serializing_if = "String::is_empty")]
+    pub runtime: String,
+    #[serde(rename = "JIT_CODE_CACHE_SIZE")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub jit_code_cache_size: Option<u32>,
+    #[serde(rename = "LLVM_JIT_OPT_LEVEL")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub llvm_jit_opt_level: Option<u32>,
+    #[serde(rename = "LLVM_JIT_SIZE_LEVEL")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub llvm_jit_size_level: Option<u32>,
+    #[serde(rename = "CACHE")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub cache: bool,
+    #[serde(rename = "SNAPSHOT")]
+    #[serde(skip_serializing_if = "String::is_empty")]
+    pub snapshot: String,
+    #[serde(rename = "TRUSTED")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub trusted: bool,
+    #[serde(rename = "FAST_EXIT")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub fast_exit: bool,
+    #[serde(rename = "STACK")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub stack_size: Option<u32>,
+    #[serde(rename = "HEAP")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub heap_size: Option<u32>,
+    // MAX_MEMORY in 64KiB Wasm pages, 4GB doesn't fit a u32 byte size
+    #[serde(rename = "MAX_MEMORY_PAGES")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub max_memory_pages: Option<u32>,
+    #[serde(rename = "HUGEPAGES")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub hugepages: bool,
+    #[serde(rename = "HEAP_POOL")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub heap_pool_size: Option<u32>,
+    // set when packing, the AOT image needs FSGSBASE
+    #[serde(rename = "AOT_SEGUE")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub aot_segue: bool,
+    // set when packing, the AOT image is instrumented for PGO
+    #[serde(rename = "PGO_TRAIN")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub pgo_train: bool,
+    // set when packing, the module needs the LLVM JIT or AOT code
+    #[serde(rename = "SIMD")]
+    #[serde(skip_serializing_if = "std::ops::Not::not")]
+    pub simd: bool,
+    // set when packing, hermit-base registers host functions for these
+    // modules only, None when unknown and empty when there are no imports
+    #[serde(rename = "IMPORT_MODULES")]
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub import_modules: Option<Vec<String>>,
+    // set when packing, keys the native code cache
+    #[serde(rename = "WASM_SHA256")]
+    #[serde(skip_serializing_if = "String::is_empty")]
+    pub wasm_sha256: String,
     // not supported yet:
     #[serde(rename = "FROM")]
     #[serde(skip_serializing_if = "String::is_empty")]
@@ -41,6 +107,48 @@ struct Hermitfile {
     pub entrypoint: String,
 }
 
+// alignment of the entries hermit-base maps from the executable
+const PAGE_SIZE: u16 = 4096;
+
+const RUNTIMES: [&str; 4] = ["interp", "fast-jit", "llvm-jit", "multi-tier"];
+
+const WASM_PAGE_SIZE: u64 = 64 << 10;
+
+// parses a byte size with an optional K, M or G suffix, up to max
+fn parse_bytes(directive: &str, size: &str, max: u64) -> u64 {
+    let (digits, multiplier) = match size.char_indices().last() {
+        Some((i, 'K' | 'k')) => (&size[..i], 1 << 10),
+        Some((i, 'M' | 'm')) => (&size[..i], 1 << 20),
+        Some((i, 'G' | 'g')) => (&size[..i], 1 << 30),
+        _ => (size, 1),
+    };
+    match digits.parse::<u64>().map(|n| n.checked_mul(multiplier)) {
+        Ok(Some(n)) if n <= max => n,
+        _ => panic!("{directive}: invalid size {size:?}"),
+    }
+}
+
+fn parse_size(directive: &str, size: &str) -> u32 {
+    parse_bytes(directive, size, u32::MAX as u64) as u32
+}
+
+// parses a linear memory size, a whole number of Wasm pages up to 4GB
+fn parse_memory_pages(directive: &str, size: &str) -> u32 {
+    let bytes = parse_bytes(directive, size, 1 << 32);
+    if bytes == 0 || bytes % WASM_PAGE_SIZE != 0 {
+        panic!("{directive}: {size:?} is not a multiple of the 64K Wasm page size");
+    }
+    (bytes / WASM_PAGE_SIZE) as u32
+}
+
+// parses an LLVM optimization or size level
+fn parse_level(directive: &str, level: &str) -> u32 {
+    match level.parse::<u32>() {
+        Ok(n @ 1..=3) => n,
+        _ => panic!("{directive}: expected a level from 1 to 3, got {level:?}"),
+    }
+}
+
 fn parse_hermitfile(hermitfile_path: &std::ffi::OsStr) -> Hermitfile {
     let hf = {
         let dockerfile = {
@@ -111,6 +219,47 @@ fn parse_hermitfile(hermitfile_path: &std::ffi::OsStr) -> Hermitfile {
             }
             Instruction::EnvPwdIsHostCwd(_) => hermitfile.uses_host_cwd = true,
             Instruction::EnvExeIsHostCwd(_) => hermitfile.uses_host_exe_name = true,
+            // directives unknown to the Dockerfile grammar
+            Instruction::Misc(ins) => {
+                let directive = ins.instruction.content.to_uppercase();
+                let argument = ins.arguments.to_string();
+                let argument = argument.trim();
+                match directive.as_str() {
+                    "RUNTIME" => {
+                        if !RUNTIMES.contains(&argument) {
+                            panic!("RUNTIME must be one of {:?}, got {:?}", RUNTIMES, argument);
+                        }
+                        hermitfile.runtime = argument.to_string();
+                    }
+                    "JIT_CODE_CACHE_SIZE" => {
+                        hermitfile.jit_code_cache_size = Some(parse_size(&directive, argument));
+                    }
+                    "LLVM_JIT_OPT_LEVEL" => {
+                        hermitfile.llvm_jit_opt_level = Some(parse_level(&directive, argument));
+                    }
+                    "LLVM_JIT_SIZE_LEVEL" => {
+                        hermitfile.llvm_jit_size_level = Some(parse_level(&directive, argument));
+                    }
+                    "CACHE" => hermitfile.cache = true,
+                    "SNAPSHOT" => {
+                        if argument.is_empty() || argument.contains(char::is_whitespace) {
+                            panic!("SNAPSHOT takes the name of an init export, got {argument:?}");
+                        }
+                        hermitfile.snapshot = argument.to_string();
+                    }
+                    "TRUSTED" | "NO_BOUNDS_CHECKS" => hermitfile.trusted = true,
+                    "FAST_EXIT" => hermitfile.fast_exit = true,
+                    "HUGEPAGES" => hermitfile.hugepages = true,
+                    "STACK" => hermitfile.stack_size = Some(parse_size(&directive, argument)),
+                    "HEAP" => hermitfile.heap_size = Some(parse_size(&directive, argument)),
+                    "HEAP_POOL" => hermitfile.heap_pool_size = Some(parse_size(&directive, argument)),
+                    "MAX_MEMORY" => {
+                        hermitfile.max_memory_pages = Some(parse_memory_pages(&directive, argument));
+                    }
+                    // a typo would otherwise pack a hermit without the setting
+                    _ => panic!("unknown Hermitfile directive {:?}", ins.instruction.content),
+                }
+            }
             _ => {}
         }
     }
@@ -131,33 +280,123 @@ fn parse_hermitfile(hermitfile_path: &std::ffi::OsStr) -> Hermitfile {
     hermitfile
 }
 
-fn create_hermit_executable(output_exe_name: &std::ffi::OsStr, hermit: Hermitfile) {
+// the part of an APE in front of its zip, which is what a hermit is
+// appended to
+fn read_base<R: Read + Seek>(mut exe: zip::ZipArchive<R>) -> Vec<u8> {
+    // HACK .offset() doesn't appear to work
+    // instead use the offset of the first file header
+    let first_file_offset = exe.by_index(0).unwrap().header_start();
+    let mut base: Vec<u8> = vec![0; first_file_offset.try_into().unwrap()];
+    let mut exe_file = exe.into_inner();
+    exe_file.seek(SeekFrom::Start(0)).unwrap();
+    exe_file.read_exact(base.as_mut_slice()).unwrap();
+    base
+}
+
+// a hermit-base flavor carried by the packer's own executable
+fn open_flavor<R: Read + Seek>(
+    exe: &mut zip::ZipArchive<R>,
+    name: &str,
+) -> zip::ZipArchive<std::io::Cursor<Vec<u8>>> {
+    let mut flavor_exe = Vec::new();
+    exe.by_name(&format!("{}{name}.com", flavor::ENTRY_PREFIX))
+        .unwrap()
+        .read_to_end(&mut flavor_exe)
+        .unwrap();
+    match zip::ZipArchive::new(std::io::Cursor::new(flavor_exe)) {
+        Ok(flavor_zip) => flavor_zip,
+        _ => panic!("the {name} hermit-base is not a ZIP/APE file"),
+    }
+}
+
+// the smallest hermit-base flavor carried by the packer's own executable
+// that runs the hermit, or the one asked for with `--flavor`. Sizes are of
+// the part read_base puts in front of the hermit.
+fn select_flavor<R: Read + Seek>(
+    exe: &mut zip::ZipArchive<R>,
+    hermit: &Hermitfile,
+    has_aot: bool,
+    requested: Option<&str>,
+) -> String {
+    let names: Vec<String> = exe
+        .file_names()
+        .filter_map(|name| name.strip_prefix(flavor::ENTRY_PREFIX))
+        .filter_map(|name| name.strip_suffix(".com"))
+        .map(str::to_string)
+        .collect();
+    if let Some(requested) = requested {
+        if requested != flavor::FULL && !names.iter().any(|name| name == requested) {
+            panic!("--flavor: this hermit.com has no {requested:?} hermit-base");
+        }
+        if !flavor::satisfies(requested, hermit, has_aot) {
+            println!("warning: the {requested} hermit-base can't run all of this hermit");
+        }
+        return requested.to_string();
+    }
+    let mut best = (
+        flavor::FULL.to_string(),
+        exe.by_index(0).unwrap().header_start(),
+    );
+    for name in names {
+        if !flavor::satisfies(&name, hermit, has_aot) {
+            continue;
+        }
+        let mut flavor_zip = open_flavor(exe, &name);
+        let size = flavor_zip.by_index(0).unwrap().header_start();
+        if size < best.1 {
+            best = (name, size);
+        }
+    }
+    best.0
+}
+
+fn create_hermit_executable(
+    output_exe_name: &std::ffi::OsStr,
+    mut hermit: Hermitfile,
+    aot_path: Option<&std::ffi::OsStr>,
+    snapshot_path: Option<&std::ffi::OsStr>,
+    requested_flavor: Option<&str>,
+    base_flavors: &[String],
+) {
+    let wasm = match std::fs::read(&hermit.from) {
+        Ok(wasm) => wasm,
+        _ => panic!("Error opening {}", hermit.from),
+    };
+    hermit.wasm_sha256 = format!("{:x}", Sha256::digest(&wasm));
+    hermit.simd = wasm::uses_simd(&wasm);
+    hermit.import_modules = wasm::import_modules(&wasm);
+    // JIT and AOT code has its bounds checks compiled in
+    if hermit.trusted && (hermit.runtime != "interp" || aot_path.is_some()) {
+        println!("warning: TRUSTED only skips bounds checks with RUNTIME interp and without --aot");
+    }
+
     // load executable to use as the hermit
     let (input_exe, input_perms) = {
-        let (input_exe_size, mut input_exe_file) = {
-            let input_exe_name = match std::env::var("EXE_NAME") {
-                Ok(input_exe_name) => input_exe_name,
-                _ => panic!("$EXE_NAME must be provided to build a hermit executable"),
-            };
-            let input_exe_file = match std::fs::File::open(&input_exe_name) {
-                Ok(input_exe_file) => input_exe_file,
-                _ => panic!("Error opening {input_exe_name}"),
-            };
-            let mut input_exe_zip = match zip::ZipArchive::new(input_exe_file) {
-                Ok(input_exe_file) => input_exe_file,
-                _ => panic!("Error opening {input_exe_name}, is it a ZIP/APE file?"),
-            };
-            // HACK .offset() doesn't appear to work
-            // instead use the offset of the first file header
-            let first_file_offset = input_exe_zip.by_index(0).unwrap().header_start();
-            let mut exe_file = input_exe_zip.into_inner();
-            exe_file.seek(SeekFrom::Start(0)).unwrap();
-            (first_file_offset.try_into().unwrap(), exe_file)
+        let input_exe_name = match std::env::var("EXE_NAME") {
+            Ok(input_exe_name) => input_exe_name,
+            _ => panic!("$EXE_NAME must be provided to build a hermit executable"),
+        };
+        let input_exe_file = match std::fs::File::open(&input_exe_name) {
+            Ok(input_exe_file) => input_exe_file,
+            _ => panic!("Error opening {input_exe_name}"),
         };
-        let mut input_exe: Vec<u8> = vec![0; input_exe_size];
-        input_exe_file.read_exact(input_exe.as_mut_slice()).unwrap();
         let perms = input_exe_file.metadata().unwrap().permissions();
-        (input_exe, perms)
+        let mut input_exe_zip = match zip::ZipArchive::new(input_exe_file) {
+            Ok(input_exe_file) => input_exe_file,
+            _ => panic!("Error opening {input_exe_name}, is it a ZIP/APE file?"),
+        };
+        let flavor = select_flavor(
+            &mut input_exe_zip,
+            &hermit,
+            aot_path.is_some(),
+            requested_flavor,
+        );
+        if flavor == flavor::FULL {
+            (read_base(input_exe_zip), perms)
+        } else {
+            println!("using the {flavor} hermit-base");
+            (read_base(open_flavor(&mut input_exe_zip, &flavor)), perms)
+        }
     };
 
     // create the output executable
@@ -171,6 +410,8 @@ fn create_hermit_executable(output_exe_name: &std::ffi::OsStr, hermit: Hermitfil
 
     // append the zipped files
     let mut zip = zip::ZipWriter::new(file);
+    let stored =
+        zip::write::FileOptions::default().compression_method(zip::CompressionMethod::Stored);
     {
         zip.start_file("hermit.json", zip::write::FileOptions::default())
             .unwrap();
@@ -178,14 +419,61 @@ fn create_hermit_executable(output_exe_name: &std::ffi::OsStr, hermit: Hermitfil
         zip.write_all(hermit_json.as_bytes()).unwrap();
     }
     {
-        zip.start_file("main.wasm", zip::write::FileOptions::default())
+        // what hermit-base reads, hermit.json is kept for people and older
+        // hermit-base versions
+        zip.start_file_aligned("hermit.cfg", stored, PAGE_SIZE)
+            .unwrap();
+        zip.write_all(&config::encode(&hermit)).unwrap();
+    }
+    {
+        // stored and page aligned too, the loader parses it from the mapping
+        // instead of an inflated heap copy
+        zip.start_file_aligned("main.wasm", stored, PAGE_SIZE)
             .unwrap();
-        let wasm = match std::fs::read(&hermit.from) {
-            Ok(wasm) => wasm,
-            _ => panic!("Error opening {}", hermit.from),
-        };
         zip.write_all(&wasm).unwrap();
     }
+    if let Some(aot_path) = aot_path {
+        // stored and page aligned so the hermit can map it straight from the
+        // executable and run XIP images in place
+        zip.start_file_aligned("main.aot", stored, PAGE_SIZE)
+            .unwrap();
+        let aot = match std::fs::read(aot_path) {
+            Ok(aot) => aot,
+            _ => panic!("Error opening {:?}", aot_path),
+        };
+        zip.write_all(&aot).unwrap();
+    }
+    if let Some(snapshot_path) = snapshot_path {
+        let snapshot = match std::fs::read(snapshot_path) {
+            Ok(snapshot) => snapshot,
+            _ => panic!("Error opening {:?}", snapshot_path),
+        };
+        // header: magic, version, sha256 of the wasm it was taken of
+        if snapshot.len() < 72 || &snapshot[..4] != b"HSNP" {
+            panic!("{:?} is not a hermit snapshot", snapshot_path);
+        }
+        if snapshot[8..72] != *hermit.wasm_sha256.as_bytes() {
+            panic!("{:?} was taken of a different Wasm module", snapshot_path);
+        }
+        // mapped like main.wasm
+        zip.start_file_aligned("snapshot.bin", stored, PAGE_SIZE)
+            .unwrap();
+        zip.write_all(&snapshot).unwrap();
+    }
+    for base_flavor in base_flavors {
+        // only read by the packer, when this hermit is hermit.com
+        let (name, path) = base_flavor.split_once('=').unwrap();
+        let flavor_exe = match std::fs::read(path) {
+            Ok(flavor_exe) => flavor_exe,
+            _ => panic!("Error opening {path}"),
+        };
+        zip.start_file(
+            format!("{}{name}.com", flavor::ENTRY_PREFIX),
+            zip::write::FileOptions::default(),
+        )
+        .unwrap();
+        zip.write_all(&flavor_exe).unwrap();
+    }
     zip.finish().unwrap();
 }
 
@@ -202,6 +490,46 @@ struct HermitCliArgs {
     /// `chmod` function.
     #[arg(default_value = "main.wasm", short = 'o')]
     output_path: std::ffi::OsString,
+    /// AOT image of the `FROM` module
+    ///
+    /// compiled ahead of time with `wamrc`, for example
+    /// `wamrc --target=x86_64 -o main.aot main.wasm`. The hermit runs it
+    /// instead of interpreting the Wasm, falling back to the interpreter if
+    /// the image can't be loaded.
+    #[arg(long = "aot", short = 'a')]
+    aot_path: Option<std::ffi::OsString>,
+    /// The AOT image was compiled with `wamrc --enable-segue`
+    ///
+    /// hermits fall back to the Wasm on CPUs or kernels without FSGSBASE
+    /// support instead of crashing.
+    #[arg(long = "aot-segue", requires = "aot_path")]
+    aot_segue: bool,
+    /// The AOT image was compiled with `wamrc --enable-llvm-pgo`
+    ///
+    /// running the hermit writes the LLVM profile of the run to
+    /// `$HERMIT_PGO_PROFILE` (default `hermit.profraw`), merge it with
+    /// `llvm-profdata` and pass it to `wamrc --use-prof-file` to build the
+    /// optimized image. `pgo_hermit.sh` does all of it.
+    #[arg(long = "pgo-train", requires = "aot_path")]
+    pgo_train: bool,
+    /// Snapshot of the state after the Hermitfile's `SNAPSHOT` export ran
+    ///
+    /// taken by running a hermit of the same Hermitfile with
+    /// `HERMIT_SNAPSHOT_CAPTURE=<path>`, hermits packed with it start from
+    /// that state instead of running the export. `snapshot_hermit.sh` does
+    /// both steps.
+    #[arg(long = "snapshot")]
+    snapshot_path: Option<std::ffi::OsString>,
+    /// hermit-base flavor to use instead of the smallest one that fits
+    ///
+    /// `full` is the hermit-base this hermit.com runs on, the others are
+    /// smaller builds without some of the engines. By default the smallest
+    /// flavor that runs the hermit as `full` would is used.
+    #[arg(long = "flavor")]
+    flavor: Option<String>,
+    /// Carry a hermit-base flavor as `<name>=<path>`, used to build hermit.com
+    #[arg(long = "base-flavor", hide = true)]
+    base_flavors: Vec<String>,
 }
 
 impl HermitCliArgs {
@@ -217,6 +545,29 @@ fn main() {
         std::env::set_current_dir(input_wd).unwrap();
     }
     let options = HermitCliArgs::parse_args();
-    let hermit = parse_hermitfile(&options.hermitfile_path);
-    create_hermit_executable(&options.output_path, hermit);
+    let mut hermit = parse_hermitfile(&options.hermitfile_path);
+    hermit.aot_segue = options.aot_segue;
+    hermit.pgo_train = options.pgo_train;
+    if options.snapshot_path.is_some() && hermit.snapshot.is_empty() {
+        panic!("--snapshot needs a SNAPSHOT directive in the Hermitfile");
+    }
+    if let Some(requested) = options.flavor.as_deref() {
+        if !flavor::is_known(requested) {
+            panic!("--flavor: unknown hermit-base flavor {requested:?}");
+        }
+    }
+    for base_flavor in &options.base_flavors {
+        match base_flavor.split_once('=') {
+            Some((name, _)) if name != flavor::FULL && flavor::is_known(name) => {}
+            _ => panic!("--base-flavor: expected <name>=<path>, got {base_flavor:?}"),
+        }
+    }
+    create_hermit_executable(
+        &options.output_path,
+        hermit,
+        options.aot_path.as_deref(),
+        options.snapshot_path.as_deref(),
+        options.flavor.as_deref(),
+        &options.base_flavors,
+    );
 }
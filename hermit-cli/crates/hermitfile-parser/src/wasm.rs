@@ -0,0 +1,443 @@
+// Minimal Wasm binary reader, only what packing needs to know about the
+// module. Malformed input is reported as "feature not used", the hermit's
+// loader is the one that rejects it.
+
+const SECTION_TYPE: u8 = 1;
+const SECTION_IMPORT: u8 = 2;
+const SECTION_GLOBAL: u8 = 6;
+const SECTION_CODE: u8 = 10;
+
+const TYPE_V128: u8 = 0x7b;
+const PREFIX_MISC: u8 = 0xfc;
+const PREFIX_SIMD: u8 = 0xfd;
+const PREFIX_ATOMIC: u8 = 0xfe;
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn new(bytes: &'a [u8]) -> Self {
+        Reader { bytes, pos: 0 }
+    }
+
+    fn at_end(&self) -> bool {
+        self.pos >= self.bytes.len()
+    }
+
+    fn byte(&mut self) -> Option<u8> {
+        let b = *self.bytes.get(self.pos)?;
+        self.pos += 1;
+        Some(b)
+    }
+
+    fn bytes(&mut self, len: usize) -> Option<&'a [u8]> {
+        let end = self.pos.checked_add(len)?;
+        let slice = self.bytes.get(self.pos..end)?;
+        self.pos = end;
+        Some(slice)
+    }
+
+    // skips a LEB128 of any width and signedness
+    fn skip_leb(&mut self) -> Option<()> {
+        while self.byte()? & 0x80 != 0 {}
+        Some(())
+    }
+
+    // at most 5 bytes, as the spec allows for a u32
+    fn u32(&mut self) -> Option<u32> {
+        let mut result: u32 = 0;
+        for shift in (0..35).step_by(7) {
+            let b = self.byte()?;
+            result |= ((b & 0x7f) as u32) << shift;
+            if b & 0x80 == 0 {
+                return Some(result);
+            }
+        }
+        None
+    }
+
+    fn skip_memarg(&mut self) -> Option<()> {
+        self.skip_leb()?;
+        self.skip_leb()
+    }
+
+    fn skip_limits(&mut self) -> Option<()> {
+        let flags = self.byte()?;
+        self.skip_leb()?;
+        if flags & 1 != 0 {
+            self.skip_leb()?;
+        }
+        Some(())
+    }
+
+    fn name(&mut self) -> Option<&'a str> {
+        let len = self.u32()?;
+        std::str::from_utf8(self.bytes(len as usize)?).ok()
+    }
+}
+
+// (id, payload) of each section, None if it isn't a module or a section is
+// cut off
+fn sections(wasm: &[u8]) -> Option<Vec<(u8, &[u8])>> {
+    if wasm.len() < 8 || &wasm[..4] != b"\0asm" {
+        return None;
+    }
+    let mut sections = Vec::new();
+    let mut reader = Reader::new(&wasm[8..]);
+    while !reader.at_end() {
+        let id = reader.byte()?;
+        let size = reader.u32()?;
+        sections.push((id, reader.bytes(size as usize)?));
+    }
+    Some(sections)
+}
+
+// true if an instruction sequence contains a SIMD instruction, None if it
+// can't be decoded
+fn code_uses_simd(code: &mut Reader) -> Option<bool> {
+    while !code.at_end() {
+        match code.byte()? {
+            PREFIX_SIMD => return Some(true),
+            // block, loop, if: the block type is a value type or an s33
+            0x02..=0x04 => code.skip_leb()?,
+            // br, br_if, call, local.*, global.*, table.get/set, ref.func
+            0x0c | 0x0d | 0x10 | 0x12 | 0x20..=0x26 | 0xd2 => code.skip_leb()?,
+            // br_table
+            0x0e => {
+                for _ in 0..=code.u32()? {
+                    code.skip_leb()?;
+                }
+            }
+            // call_indirect, return_call_indirect
+            0x11 | 0x13 => {
+                code.skip_leb()?;
+                code.skip_leb()?;
+            }
+            // typed select
+            0x1c => {
+                let count = code.u32()?;
+                if code.bytes(count as usize)?.contains(&TYPE_V128) {
+                    return Some(true);
+                }
+            }
+            // loads and stores
+            0x28..=0x3e => code.skip_memarg()?,
+            // memory.size, memory.grow, ref.null
+            0x3f | 0x40 | 0xd0 => {
+                code.byte()?;
+            }
+            // i32.const, i64.const
+            0x41 | 0x42 => code.skip_leb()?,
+            0x43 => {
+                code.bytes(4)?;
+            }
+            0x44 => {
+                code.bytes(8)?;
+            }
+            PREFIX_MISC => match code.u32()? {
+                // saturating truncations
+                0..=7 => {}
+                // memory.init
+                8 => {
+                    code.skip_leb()?;
+                    code.byte()?;
+                }
+                // memory.copy
+                10 => {
+                    code.bytes(2)?;
+                }
+                // memory.fill
+                11 => {
+                    code.byte()?;
+                }
+                // table.init, table.copy
+                12 | 14 => {
+                    code.skip_leb()?;
+                    code.skip_leb()?;
+                }
+                // data.drop, elem.drop, table.grow/size/fill
+                9 | 13 | 15..=17 => code.skip_leb()?,
+                _ => return None,
+            },
+            PREFIX_ATOMIC => match code.u32()? {
+                // atomic.fence
+                3 => {
+                    code.byte()?;
+                }
+                _ => code.skip_memarg()?,
+            },
+            // everything else in the MVP and the other finished proposals
+            // has no immediates
+            0x00 | 0x01 | 0x05 | 0x0b | 0x0f | 0x1a | 0x1b | 0x45..=0xc4 | 0xd1 => {}
+            _ => return None,
+        }
+    }
+    Some(false)
+}
+
+fn code_section_uses_simd(payload: &[u8]) -> Option<bool> {
+    let mut reader = Reader::new(payload);
+    for _ in 0..reader.u32()? {
+        let size = reader.u32()?;
+        let mut body = Reader::new(reader.bytes(size as usize)?);
+        for _ in 0..body.u32()? {
+            body.skip_leb()?;
+            if body.byte()? == TYPE_V128 {
+                return Some(true);
+            }
+        }
+        if code_uses_simd(&mut body)? {
+            return Some(true);
+        }
+    }
+    Some(false)
+}
+
+fn type_section_uses_simd(payload: &[u8]) -> Option<bool> {
+    let mut reader = Reader::new(payload);
+    for _ in 0..reader.u32()? {
+        // only function types exist outside of the GC proposal
+        if reader.byte()? != 0x60 {
+            return None;
+        }
+        for _ in 0..2 {
+            let count = reader.u32()?;
+            if reader.bytes(count as usize)?.contains(&TYPE_V128) {
+                return Some(true);
+            }
+        }
+    }
+    Some(false)
+}
+
+fn global_section_uses_simd(payload: &[u8]) -> Option<bool> {
+    let mut reader = Reader::new(payload);
+    for _ in 0..reader.u32()? {
+        if reader.byte()? == TYPE_V128 {
+            return Some(true);
+        }
+        // mutability
+        reader.byte()?;
+        // constant init expression, ends with `end`
+        loop {
+            match reader.byte()? {
+                0x0b => break,
+                PREFIX_SIMD => return Some(true),
+                0x41 | 0x42 | 0x23 | 0xd2 => reader.skip_leb()?,
+                0x43 => {
+                    reader.bytes(4)?;
+                }
+                0x44 => {
+                    reader.bytes(8)?;
+                }
+                0xd0 => {
+                    reader.byte()?;
+                }
+                // extended constant expressions
+                0x6a..=0x6c | 0x7c..=0x7e => {}
+                _ => return None,
+            }
+        }
+    }
+    Some(false)
+}
+
+fn import_section_modules(payload: &[u8]) -> Option<Vec<String>> {
+    let mut reader = Reader::new(payload);
+    let mut modules: Vec<String> = Vec::new();
+    for _ in 0..reader.u32()? {
+        let module = reader.name()?;
+        reader.name()?;
+        match reader.byte()? {
+            // function, tag
+            0x00 => reader.skip_leb()?,
+            0x04 => {
+                reader.byte()?;
+                reader.skip_leb()?;
+            }
+            // table: element type and limits
+            0x01 => {
+                reader.byte()?;
+                reader.skip_limits()?;
+            }
+            0x02 => reader.skip_limits()?,
+            // global: value type and mutability
+            0x03 => {
+                reader.bytes(2)?;
+            }
+            _ => return None,
+        }
+        if !modules.iter().any(|m| m == module) {
+            modules.push(module.to_string());
+        }
+    }
+    Some(modules)
+}
+
+/// Returns the distinct module names the module imports from, in order of
+/// first use, or None if the module can't be read. An empty list means the
+/// module imports nothing.
+pub fn import_modules(wasm: &[u8]) -> Option<Vec<String>> {
+    match sections(wasm)?
+        .iter()
+        .find(|&&(id, _)| id == SECTION_IMPORT)
+    {
+        Some(&(_, payload)) => import_section_modules(payload),
+        None => Some(Vec::new()),
+    }
+}
+
+/// Returns true if the module uses the fixed-width SIMD proposal (simd128),
+/// which WAMR only runs with the LLVM JIT or AOT compiled code.
+pub fn uses_simd(wasm: &[u8]) -> bool {
+    sections(wasm)
+        .unwrap_or_default()
+        .iter()
+        .any(|&(id, payload)| {
+            match id {
+                SECTION_TYPE => type_section_uses_simd(payload),
+                SECTION_GLOBAL => global_section_uses_simd(payload),
+                SECTION_CODE => code_section_uses_simd(payload),
+                _ => Some(false),
+            }
+            .unwrap_or(false)
+        })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const FUNC_TYPE: u8 = 0x60;
+    const SECTION_FUNCTION: u8 = 3;
+    // v128.const of 16 zero bytes
+    const V128_CONST: [u8; 18] = {
+        let mut v128_const = [0; 18];
+        v128_const[0] = PREFIX_SIMD;
+        v128_const[1] = 0x0c;
+        v128_const
+    };
+
+    // a module from (id, payload) sections, payloads shorter than 128 bytes
+    fn module(sections: &[(u8, Vec<u8>)]) -> Vec<u8> {
+        let mut wasm = b"\0asm\x01\0\0\0".to_vec();
+        for (id, payload) in sections {
+            wasm.push(*id);
+            wasm.push(payload.len() as u8);
+            wasm.extend_from_slice(payload);
+        }
+        wasm
+    }
+
+    // one `() -> ()` function with the given body, locals included
+    fn function(body: &[u8]) -> Vec<u8> {
+        let mut code = vec![1, body.len() as u8];
+        code.extend_from_slice(body);
+        module(&[
+            (SECTION_TYPE, vec![1, FUNC_TYPE, 0, 0]),
+            (SECTION_FUNCTION, vec![1, 0]),
+            (SECTION_CODE, code),
+        ])
+    }
+
+    fn import(module: &str, name: &str) -> Vec<u8> {
+        let mut entry = vec![module.len() as u8];
+        entry.extend_from_slice(module.as_bytes());
+        entry.push(name.len() as u8);
+        entry.extend_from_slice(name.as_bytes());
+        // function of type 0
+        entry.extend_from_slice(&[0x00, 0]);
+        entry
+    }
+
+    #[test]
+    fn simd_instruction_in_function_body() {
+        let mut body = vec![0];
+        body.extend_from_slice(&V128_CONST);
+        body.extend_from_slice(&[0x1a, 0x0b]);
+        assert!(uses_simd(&function(&body)));
+    }
+
+    #[test]
+    fn v128_local() {
+        assert!(uses_simd(&function(&[1, 1, TYPE_V128, 0x0b])));
+    }
+
+    #[test]
+    fn scalar_function_body() {
+        // i32.const 1, i64.const -1, drop, drop, memory.size, drop
+        assert!(!uses_simd(&function(&[
+            0, 0x41, 1, 0x42, 0x7f, 0x1a, 0x1a, 0x3f, 0, 0x1a, 0x0b
+        ])));
+    }
+
+    #[test]
+    fn v128_global_only() {
+        let mut global = vec![1, TYPE_V128, 0];
+        global.extend_from_slice(&V128_CONST);
+        global.push(0x0b);
+        assert!(uses_simd(&module(&[(SECTION_GLOBAL, global)])));
+    }
+
+    #[test]
+    fn v128_in_type_signature_only() {
+        let types = vec![1, FUNC_TYPE, 1, TYPE_V128, 0];
+        assert!(uses_simd(&module(&[(SECTION_TYPE, types)])));
+        let types = vec![1, FUNC_TYPE, 0, 1, TYPE_V128];
+        assert!(uses_simd(&module(&[(SECTION_TYPE, types)])));
+    }
+
+    #[test]
+    fn module_without_imports() {
+        assert_eq!(import_modules(&function(&[0, 0x0b])), Some(Vec::new()));
+    }
+
+    #[test]
+    fn module_with_imports() {
+        let mut imports = vec![3];
+        imports.extend(import("wasi_snapshot_preview1", "fd_write"));
+        imports.extend(import("env", "abort"));
+        imports.extend(import("wasi_snapshot_preview1", "proc_exit"));
+        let wasm = module(&[
+            (SECTION_TYPE, vec![1, FUNC_TYPE, 0, 0]),
+            (SECTION_IMPORT, imports),
+        ]);
+        assert_eq!(
+            import_modules(&wasm),
+            Some(vec![
+                "wasi_snapshot_preview1".to_string(),
+                "env".to_string()
+            ])
+        );
+    }
+
+    #[test]
+    fn truncated_leb() {
+        // the function count of the code section ends mid LEB128
+        let wasm = module(&[(SECTION_CODE, vec![0x80])]);
+        assert!(!uses_simd(&wasm));
+        let wasm = module(&[(SECTION_IMPORT, vec![0x81, 0x80])]);
+        assert_eq!(import_modules(&wasm), None);
+        // the section size itself is cut off
+        let mut wasm = module(&[]);
+        wasm.extend_from_slice(&[SECTION_CODE, 0xff]);
+        assert!(!uses_simd(&wasm));
+        assert_eq!(import_modules(&wasm), None);
+    }
+
+    #[test]
+    fn overlong_leb() {
+        let wasm = module(&[(SECTION_IMPORT, vec![0x80; 64])]);
+        assert_eq!(import_modules(&wasm), None);
+        let wasm = module(&[(SECTION_CODE, vec![0xff; 64])]);
+        assert!(!uses_simd(&wasm));
+    }
+
+    #[test]
+    fn not_wasm() {
+        assert!(!uses_simd(b"\0as"));
+        assert_eq!(import_modules(b""), None);
+    }
+}
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Packs a hermit with an AOT image optimized for the profile of a training run
+# usage: ./pgo_hermit.sh [-f Hermitfile] [-o output.com] [-- training args...]
+#
+# 1. compiles the FROM module with instrumentation (wamrc --enable-llvm-pgo)
+# 2. packs it with `hermit.com --pgo-train` and runs it with the training args
+#    and this script's stdin, which writes the profile
+# 3. merges the profile and compiles the final AOT image with it
+#    (wamrc --use-prof-file) into the output hermit
+#
+# HERMIT, WAMRC, WAMRC_FLAGS and LLVM_PROFDATA override the tools used.
+set -e
+
+hermit=${HERMIT:-build/hermit.com}
+wamrc=${WAMRC:-wamrc}
+wamrc_flags=${WAMRC_FLAGS:---target=x86_64}
+llvm_profdata=${LLVM_PROFDATA:-llvm-profdata}
+hermitfile=Hermitfile
+output=main.com
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -f) hermitfile=$2; shift 2 ;;
+        -o) output=$2; shift 2 ;;
+        --) shift; break ;;
+        *) echo "usage: $0 [-f Hermitfile] [-o output.com] [-- training args...]" >&2; exit 1 ;;
+    esac
+done
+
+# FROM is relative to the Hermitfile
+from=$(sed -n 's/^[Ff][Rr][Oo][Mm][[:space:]]\{1,\}\([^[:space:]]*\).*/\1/p' "$hermitfile" | head -n 1)
+if [ -z "$from" ]; then
+    echo "$hermitfile: missing FROM" >&2
+    exit 1
+fi
+wasm="$(dirname "$hermitfile")/$from"
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+$wamrc $wamrc_flags --enable-llvm-pgo -o "$work/train.aot" "$wasm"
+"$hermit" -f "$hermitfile" -o "$work/train.com" --aot "$work/train.aot" --pgo-train > /dev/null
+chmod +x "$work/train.com"
+
+HERMIT_PGO_PROFILE="$work/train.profraw" "$work/train.com" "$@"
+if [ ! -f "$work/train.profraw" ]; then
+    echo "the training run didn't write a profile" >&2
+    exit 1
+fi
+"$llvm_profdata" merge -o "$work/train.profdata" "$work/train.profraw"
+
+$wamrc $wamrc_flags --use-prof-file="$work/train.profdata" -o "$work/main.aot" "$wasm"
+"$hermit" -f "$hermitfile" -o "$output" --aot "$work/main.aot" > /dev/null
+chmod +x "$output"
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Packs a hermit that starts from a snapshot taken after its SNAPSHOT export ran
+# usage: ./snapshot_hermit.sh [-f Hermitfile] [-o output.com] [-- hermit.com args...]
+#
+# 1. packs the Hermitfile and runs the hermit with HERMIT_SNAPSHOT_CAPTURE,
+#    which runs the SNAPSHOT export and writes linear memory and globals
+# 2. packs it again with `hermit.com --snapshot`
+#
+# Arguments after -- are passed to both hermit.com runs, for example --aot.
+# HERMIT overrides the hermit.com used.
+set -e
+
+hermit=${HERMIT:-build/hermit.com}
+hermitfile=Hermitfile
+output=main.com
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -f) hermitfile=$2; shift 2 ;;
+        -o) output=$2; shift 2 ;;
+        --) shift; break ;;
+        *) echo "usage: $0 [-f Hermitfile] [-o output.com] [-- hermit.com args...]" >&2; exit 1 ;;
+    esac
+done
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$hermit" -f "$hermitfile" -o "$work/capture.com" "$@" > /dev/null
+chmod +x "$work/capture.com"
+HERMIT_SNAPSHOT_CAPTURE="$work/snapshot.bin" "$work/capture.com"
+
+"$hermit" -f "$hermitfile" -o "$output" --snapshot "$work/snapshot.bin" "$@" > /dev/null
+chmod +x "$output"
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "cache.h"
+
+#ifndef HERMIT_WAMR_VERSION
+#define HERMIT_WAMR_VERSION "unknown"
+#endif
+
+bool hermit_cache_default_dir(char *dir, const size_t dir_size)
+{
+    const char *env;
+    int len;
+    if ((env = getenv("HERMIT_CACHE_DIR")) != NULL && *env != '\0')
+    {
+        len = snprintf(dir, dir_size, "%s", env);
+    }
+    else if ((env = getenv("XDG_CACHE_HOME")) != NULL && *env != '\0')
+    {
+        len = snprintf(dir, dir_size, "%s/hermit", env);
+    }
+    else if ((env = getenv("HOME")) != NULL && *env != '\0')
+    {
+        len = snprintf(dir, dir_size, "%s/.cache/hermit", env);
+    }
+    else
+    {
+        return false;
+    }
+    return len > 0 && (size_t)len < dir_size;
+}
+
+// like `mkdir -p`, tolerating other hermits creating the same directories
+static bool mkdir_p(const char *dir)
+{
+    char path[PATH_MAX];
+    const size_t len = strlen(dir);
+    if (len >= sizeof(path))
+    {
+        return false;
+    }
+    memcpy(path, dir, len + 1);
+    for (char *p = path + 1; *p != '\0'; p++)
+    {
+        if (*p != '/')
+        {
+            continue;
+        }
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        {
+            return false;
+        }
+        *p = '/';
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+// code compiled for the host CPU is only valid on CPUs with the same features
+static uint32_t get_cpu_features_hash(void)
+{
+    uint32_t hash = 2166136261u;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int regs[8] = {0};
+    __get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]);
+    __get_cpuid_count(7, 0, &regs[4], &regs[5], &regs[6], &regs[7]);
+    // family/model/stepping of leaf 1 eax, features in ecx/edx and leaf 7
+    const uint32_t features[] = {regs[0], regs[2], regs[3], regs[5], regs[6], regs[7]};
+    for (size_t i = 0; i < sizeof(features) / sizeof(features[0]); i++)
+    {
+        // FNV-1a
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            hash = (hash ^ ((features[i] >> shift) & 0xff)) * 16777619u;
+        }
+    }
+#endif
+    return hash;
+}
+
+bool hermit_cache_get_path(const char *dir, const char *wasm_sha256, const char *options, char *path, const size_t path_size)
+{
+    if (!mkdir_p(dir))
+    {
+        fprintf(stderr, "hermit-base: cannot create cache directory %s\n", dir);
+        return false;
+    }
+    const int len = snprintf(path, path_size, "%s/%s-%s-%s-%08x.aot", dir, wasm_sha256, HERMIT_WAMR_VERSION, options, get_cpu_features_hash());
+    return len > 0 && (size_t)len < path_size;
+}
+
+uint8_t *hermit_cache_map(const char *path, uint32_t *size)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > UINT32_MAX)
+    {
+        close(fd);
+        return NULL;
+    }
+    // private and writable as the loader patches the buffer in place
+    void *buf = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = st.st_size;
+    return buf;
+}
+
+void hermit_cache_unmap(uint8_t *buf, const uint32_t size)
+{
+    munmap(buf, size);
+}
+
+bool hermit_cache_publish(const char *tmp_path, const char *path)
+{
+    if (rename(tmp_path, path) == 0)
+    {
+        return true;
+    }
+    // another hermit won the race on a platform where rename doesn't replace
+    unlink(tmp_path);
+    return access(path, F_OK) == 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// $HERMIT_CACHE_DIR, else $XDG_CACHE_HOME/hermit, else $HOME/.cache/hermit
+bool hermit_cache_default_dir(char *dir, const size_t dir_size);
+
+// <dir>/<wasm_sha256>-<engine version>-<options>-<cpu features>.aot, creating
+// dir. options names the compile options baked into the image.
+bool hermit_cache_get_path(const char *dir, const char *wasm_sha256, const char *options, char *path, const size_t path_size);
+
+// maps a cache entry private and writable, NULL if there is none
+uint8_t *hermit_cache_map(const char *path, uint32_t *size);
+
+void hermit_cache_unmap(uint8_t *buf, const uint32_t size);
+
+// renames a fully written tmp_path to path so concurrent readers never see a
+// partial entry, tmp_path is removed either way
+bool hermit_cache_publish(const char *tmp_path, const char *path);
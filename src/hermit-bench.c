@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+// Starts a hermit's Wasm many times in one process, the way hermit-base does
+// from its own zip, and prints the p50, p90 and p99 of each startup phase as
+// JSON. Without the exec, dynamic loading and page faults of a fresh process
+// in every sample, phases that move by microseconds show up.
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hermit-config.h"
+#include "trace.h"
+#include "wamr.h"
+#include "zipmap.h"
+
+#define BENCH_MAX_PHASES 32
+
+typedef struct
+{
+    const char *name;
+    // one sample per run, ns
+    uint64_t *samples;
+} phase_samples;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// nearest rank, samples must be sorted
+static double percentile_us(const uint64_t *samples, const uint32_t count, const uint32_t p)
+{
+    uint32_t rank = (count * p + 99) / 100;
+    return samples[rank > 0 ? rank - 1 : 0] / 1e3;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: hermit-bench [-n runs] [-w warmup runs] [-i stdin file] <hermit.com> [args...]\n");
+}
+
+// gives the guest fresh stdio for each run, WASI may close the ones it got
+static bool redirect_stdio(const char *input, const int stderr_fd)
+{
+    const int in = open(input != NULL ? input : "/dev/null", O_RDONLY);
+    const int out = open("/dev/null", O_WRONLY);
+    const bool ok = in != -1 && out != -1 && dup2(in, 0) != -1 && dup2(out, 1) != -1 && dup2(stderr_fd, 2) != -1;
+    if (in != -1)
+    {
+        close(in);
+    }
+    if (out != -1)
+    {
+        close(out);
+    }
+    return ok;
+}
+
+// one start of the hermit, with the overrides of hermit-base's main that
+// make sense for repeated runs
+static bool run_once(int argc, char *argv[], int *ret)
+{
+    defer_hermit_config hermit_config hc = {0};
+    if (!load_hermit_config(&hc))
+    {
+        return false;
+    }
+    hermit_trace_phase("config");
+    wamr_config *config = &hc.wamr;
+
+    if (!load_env_overrides(&hc))
+    {
+        return false;
+    }
+    // the process has to live on to the next run, and training runs would
+    // overwrite each other's profile
+    config->fast_exit = false;
+    config->pgo_profile = NULL;
+
+    *ret = wamr(argv[0], "/zip/main.aot", argc, argv, hc.dir_list.arr, hc.dir_list.size, hc.env_list.arr, hc.env_list.size, hc.func_name, config);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t runs = 100;
+    uint32_t warmup = 1;
+    const char *input = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "+n:w:i:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            runs = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            warmup = strtoul(optarg, NULL, 10);
+            break;
+        case 'i':
+            input = optarg;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (optind >= argc || runs == 0)
+    {
+        usage();
+        return 1;
+    }
+    const char *hermit = argv[optind];
+    hermit_zip_use(hermit);
+
+    // the guest sees the hermit's usual argv
+    const int app_argc = argc - optind;
+    defer_free char **app_argv = malloc((app_argc + 1) * sizeof(char *));
+    if (app_argv == NULL)
+    {
+        perror("hermit-bench");
+        return 1;
+    }
+    app_argv[0] = "/zip/main.wasm";
+    memcpy(&app_argv[1], &argv[optind + 1], sizeof(char *) * (app_argc - 1));
+    app_argv[app_argc] = NULL;
+
+    // the guest writes to /dev/null, the results go to the real stdout
+    const int stderr_fd = dup(2);
+    FILE *out = fdopen(dup(1), "w");
+    if (stderr_fd == -1 || out == NULL)
+    {
+        perror("hermit-bench");
+        return 1;
+    }
+
+    phase_samples phases[BENCH_MAX_PHASES];
+    uint32_t phase_count = 0;
+    defer_free uint64_t *totals = malloc(runs * sizeof(uint64_t));
+    if (totals == NULL)
+    {
+        perror("hermit-bench");
+        return 1;
+    }
+    for (uint32_t i = 0; i < warmup + runs; i++)
+    {
+        if (!redirect_stdio(input, stderr_fd))
+        {
+            perror("hermit-bench");
+            return 1;
+        }
+        const uint64_t start_ns = now_ns();
+        hermit_trace_restart();
+        int ret;
+        if (!run_once(app_argc, app_argv, &ret))
+        {
+            return 1;
+        }
+        if (ret != 0)
+        {
+            dprintf(stderr_fd, "hermit-bench: %s exited with %d\n", hermit, ret);
+            return 1;
+        }
+        if (i < warmup)
+        {
+            continue;
+        }
+        const uint32_t run = i - warmup;
+        totals[run] = now_ns() - start_ns;
+
+        const char *names[BENCH_MAX_PHASES];
+        uint64_t ns[BENCH_MAX_PHASES];
+        uint32_t count = hermit_trace_phases(names, ns, BENCH_MAX_PHASES);
+        count = count < BENCH_MAX_PHASES ? count : BENCH_MAX_PHASES;
+        for (uint32_t j = 0; j < count; j++)
+        {
+            // phases are static strings, a phase reached by some runs only
+            // counts as 0 in the others
+            uint32_t k = 0;
+            while (k < phase_count && strcmp(phases[k].name, names[j]) != 0)
+            {
+                k++;
+            }
+            if (k == phase_count)
+            {
+                if (phase_count == BENCH_MAX_PHASES)
+                {
+                    continue;
+                }
+                phases[k].name = names[j];
+                if ((phases[k].samples = calloc(runs, sizeof(uint64_t))) == NULL)
+                {
+                    perror("hermit-bench");
+                    return 1;
+                }
+                phase_count++;
+            }
+            phases[k].samples[run] += ns[j];
+        }
+    }
+
+    fprintf(out, "{\"hermit\":\"%s\",\"runs\":%u,\"unit\":\"us\",\"phases\":{", hermit, runs);
+    for (uint32_t k = 0; k <= phase_count; k++)
+    {
+        const char *name = k < phase_count ? phases[k].name : "total";
+        uint64_t *samples = k < phase_count ? phases[k].samples : totals;
+        qsort(samples, runs, sizeof(uint64_t), compare_u64);
+        fprintf(out, "%s\"%s\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f}", k > 0 ? "," : "", name, percentile_us(samples, runs, 50), percentile_us(samples, runs, 90), percentile_us(samples, runs, 99));
+        if (k < phase_count)
+        {
+            free(samples);
+        }
+    }
+    fputs("}}\n", out);
+    fclose(out);
+    return 0;
+}
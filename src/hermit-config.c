@@ -0,0 +1,859 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "cache.h"
+#include "hermit-config.h"
+#include "json.h"
+#include "zipmap.h"
+
+// cosmopolitan libc internal function
+char *GetProgramExecutableName(void);
+
+static const char *get_json_type_name(const json_type_t t)
+{
+#define X(name)       \
+    case name:        \
+        return #name; \
+        break;
+    switch (t)
+    {
+        X(json_type_string)
+        X(json_type_number)
+        X(json_type_object)
+        X(json_type_array)
+        X(json_type_true)
+        X(json_type_false)
+        X(json_type_null)
+    default:
+        return "UNKNOWN_TYPE";
+    }
+#undef X
+}
+
+// similar to C++ vector reserve
+static bool list_reserve(list *l, const uint32_t new_capacity)
+{
+    if (l->max >= new_capacity)
+        return true;
+    char **new_list = realloc(l->arr, new_capacity * sizeof(const char *));
+    if (new_list == NULL)
+    {
+        fprintf(stderr, "%s: realloc failed %u -> %u\n", __func__, l->max, new_capacity);
+        return false;
+    }
+    l->arr = new_list;
+    l->max = new_capacity;
+    return true;
+}
+
+// appends to a list, growing it geometrically
+static bool list_push(list *l, char *item)
+{
+    if (l->size == l->max && !list_reserve(l, l->max ? l->max * 2 : 16))
+    {
+        return false;
+    }
+    l->arr[l->size++] = item;
+    return true;
+}
+
+void cleanup_free(void *p)
+{
+    void **tofree = (void **)p;
+    if (*tofree == NULL)
+    {
+        return;
+    }
+    free(*tofree);
+}
+
+void cleanup_list(list *l)
+{
+    if (l->arr)
+    {
+        for (uint32_t i = 0; i < l->size; i++)
+        {
+            free(l->arr[i]);
+        }
+        free(l->arr);
+    }
+}
+#define defer_list defer(cleanup_list)
+
+void cleanup_hermit_config(hermit_config *hc)
+{
+    free(hc->dir_list.arr);
+    free(hc->env_list.arr);
+    free(hc->import_list.arr);
+    cleanup_list(&hc->strings);
+    if (hc->blob != NULL)
+    {
+        hermit_zip_unmap(hc->blob, hc->blob_size);
+    }
+}
+
+// allocates a string owned by the config
+static char *config_alloc(hermit_config *hc, const size_t size)
+{
+    char *str = malloc(size);
+    if (str != NULL && !list_push(&hc->strings, str))
+    {
+        free(str);
+        return NULL;
+    }
+    return str;
+}
+
+// copies len bytes of str and a NUL into the config's strings
+static char *config_strdup(hermit_config *hc, const char *str, const size_t len)
+{
+    char *copy = config_alloc(hc, len + 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+// adds "<name>=<value>" to the environment of the Wasm
+static bool config_push_env(hermit_config *hc, const char *name, const char *value)
+{
+    const size_t name_len = strlen(name);
+    const size_t value_len = strlen(value);
+    char *env = config_alloc(hc, name_len + 1 + value_len + 1);
+    if (env == NULL)
+    {
+        return false;
+    }
+    memcpy(env, name, name_len);
+    env[name_len] = '=';
+    memcpy(env + name_len + 1, value, value_len + 1);
+    return list_push(&hc->env_list, env);
+}
+
+// ENV_PWD_IS_HOST_CWD
+static bool config_push_host_cwd(hermit_config *hc)
+{
+    defer_free char *wd = getcwd(NULL, 0);
+    if (wd == NULL || !config_push_env(hc, "PWD", wd))
+    {
+        fprintf(stderr, "ENV_PWD_IS_HOST_CWD: failed to set PWD\n");
+        return false;
+    }
+    return true;
+}
+
+// ENV_EXE_NAME_IS_HOST_EXE_NAME
+static bool config_push_host_exe_name(hermit_config *hc)
+{
+    if (!config_push_env(hc, "EXE_NAME", GetProgramExecutableName()))
+    {
+        fprintf(stderr, "ENV_EXE_NAME_IS_HOST_EXE_NAME: failed to set EXE_NAME\n");
+        return false;
+    }
+    return true;
+}
+
+// WASM_SHA256 becomes part of a file name
+static bool is_sha256_hex(const char *str)
+{
+    size_t i = 0;
+    while (i < 64 && isxdigit((unsigned char)str[i]))
+    {
+        i++;
+    }
+    return i == 64 && str[i] == '\0';
+}
+
+// parse a non-negative integer that fits in uint32_t
+static bool parse_u32(const char *str, uint32_t *value)
+{
+    char *end;
+    errno = 0;
+    const unsigned long long n = strtoull(str, &end, 10);
+    if (end == str || *end != '\0' || *str == '-' || errno != 0 || n > UINT32_MAX)
+    {
+        return false;
+    }
+    *value = n;
+    return true;
+}
+
+bool parse_size(const char *str, uint64_t *size)
+{
+    char *end;
+    errno = 0;
+    const unsigned long long n = strtoull(str, &end, 10);
+    if (end == str || *str == '-' || errno != 0)
+    {
+        return false;
+    }
+    const unsigned shift = strcasecmp(end, "K") == 0 ? 10 : strcasecmp(end, "M") == 0 ? 20 : strcasecmp(end, "G") == 0 ? 30 : *end == '\0' ? 0 : 64;
+    if (shift == 64 || n > UINT64_MAX >> shift)
+    {
+        return false;
+    }
+    *size = (uint64_t)n << shift;
+    return true;
+}
+
+bool parse_runtime(const char *name, hermit_runtime *runtime)
+{
+    static const char *const names[] = {
+        [HERMIT_RUNTIME_INTERP] = "interp",
+        [HERMIT_RUNTIME_FAST_JIT] = "fast-jit",
+        [HERMIT_RUNTIME_LLVM_JIT] = "llvm-jit",
+        [HERMIT_RUNTIME_MULTI_TIER] = "multi-tier"};
+    for (size_t i = HERMIT_RUNTIME_INTERP; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strcmp(names[i], name) == 0)
+        {
+            *runtime = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// parses a JSON entry of the hermit's zip
+static struct json_value_s *load_json_entry(const char *name)
+{
+    uint32_t size;
+    defer_free uint8_t *json_bytes = hermit_zip_read(name, &size);
+    if (json_bytes == NULL)
+    {
+        fprintf(stderr, "error reading %s\n", name);
+        return NULL;
+    }
+    return json_parse(json_bytes, size);
+}
+
+static bool load_hermit_config_json(const char *entry, hermit_config *hc)
+{
+    wamr_config *config = &hc->wamr;
+    const bool debug = getenv("HERMIT_DEBUG_BASE") != NULL;
+    defer_free struct json_value_s *json = load_json_entry(entry);
+    if (json == NULL)
+    {
+        fprintf(stderr, "error parsing json\n");
+        return false;
+    }
+    if (json->type != json_type_object)
+    {
+        fprintf(stderr, "error json should consist of an object\n");
+        return false;
+    }
+
+    typedef enum
+    {
+        HC_UNKNOWN = -1,
+        HC_MAP,
+        HC_ENV_PWD_IS_HOST_CWD,
+        HC_ENV_EXE_NAME_IS_HOST_EXE_NAME,
+        HC_NET,
+        HC_ARGV,
+        HC_ENV,
+        HC_ENTRYPOINT,
+        HC_RUNTIME,
+        HC_JIT_CODE_CACHE_SIZE,
+        HC_LLVM_JIT_OPT_LEVEL,
+        HC_LLVM_JIT_SIZE_LEVEL,
+        HC_CACHE,
+        HC_WASM_SHA256,
+        HC_TRUSTED,
+        HC_AOT_SEGUE,
+        HC_SIMD,
+        HC_PGO_TRAIN,
+        HC_SNAPSHOT,
+        HC_FAST_EXIT,
+        HC_STACK,
+        HC_HEAP,
+        HC_MAX_MEMORY_PAGES,
+        HC_HEAP_POOL,
+        HC_HUGEPAGES,
+        HC_IMPORT_MODULES
+    } hermit_config_index;
+    typedef struct
+    {
+        const char *key;
+        json_type_t type;
+        hermit_config_index index;
+    } hermit_config_item;
+    static const hermit_config_item items[] = {
+        {"MAP", json_type_array, HC_MAP},
+        {"ENV_PWD_IS_HOST_CWD",
+         json_type_true,
+         HC_ENV_PWD_IS_HOST_CWD},
+        {"ENV_EXE_NAME_IS_HOST_EXE_NAME", json_type_true, HC_ENV_EXE_NAME_IS_HOST_EXE_NAME},
+        {"ENV", json_type_array, HC_ENV},
+        {"NET", json_type_array, HC_NET},
+        {"ARGV", json_type_array, HC_ARGV},
+        {"ENTRYPOINT", json_type_string, HC_ENTRYPOINT},
+        {"RUNTIME", json_type_string, HC_RUNTIME},
+        {"JIT_CODE_CACHE_SIZE", json_type_number, HC_JIT_CODE_CACHE_SIZE},
+        {"LLVM_JIT_OPT_LEVEL", json_type_number, HC_LLVM_JIT_OPT_LEVEL},
+        {"LLVM_JIT_SIZE_LEVEL", json_type_number, HC_LLVM_JIT_SIZE_LEVEL},
+        {"CACHE", json_type_true, HC_CACHE},
+        {"WASM_SHA256", json_type_string, HC_WASM_SHA256},
+        {"TRUSTED", json_type_true, HC_TRUSTED},
+        {"AOT_SEGUE", json_type_true, HC_AOT_SEGUE},
+        {"SIMD", json_type_true, HC_SIMD},
+        {"PGO_TRAIN", json_type_true, HC_PGO_TRAIN},
+        {"SNAPSHOT", json_type_string, HC_SNAPSHOT},
+        {"FAST_EXIT", json_type_true, HC_FAST_EXIT},
+        {"STACK", json_type_number, HC_STACK},
+        {"HEAP", json_type_number, HC_HEAP},
+        {"MAX_MEMORY_PAGES", json_type_number, HC_MAX_MEMORY_PAGES},
+        {"HEAP_POOL", json_type_number, HC_HEAP_POOL},
+        {"HUGEPAGES", json_type_true, HC_HUGEPAGES},
+        {"IMPORT_MODULES", json_type_array, HC_IMPORT_MODULES}};
+    const struct json_object_s *object = json->payload;
+    for (const struct json_object_element_s *item = object->start; item != NULL;
+         item = item->next)
+    {
+        const struct json_string_s *name = item->name;
+        hermit_config_index config_index = HC_UNKNOWN;
+        for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); i++)
+        {
+            if (strcmp(items[i].key, name->string) == 0)
+            {
+                if (items[i].type != item->value->type)
+                {
+                    fprintf(stderr, "%s: expected %s got %s!\n", items[i].key, get_json_type_name(items[i].type), get_json_type_name(item->value->type));
+                    return false;
+                }
+                config_index = items[i].index;
+                break;
+            }
+        }
+        switch (config_index)
+        {
+        case HC_MAP:
+        {
+            const struct json_array_s *value = item->value->payload;
+            if (!list_reserve(&hc->dir_list, hc->dir_list.size + value->length))
+            {
+                fprintf(stderr, "MAP: list_reserve failed\n");
+                return false;
+            }
+            for (const struct json_array_element_s *aitem = value->start; aitem != NULL; aitem = aitem->next)
+            {
+                if (aitem->value->type != json_type_string)
+                {
+                    fprintf(stderr, "MAP must be an array of strings\n");
+                    return false;
+                }
+                const struct json_string_s *string = aitem->value->payload;
+                char *dir_item = config_strdup(hc, string->string, string->string_size);
+                if (!dir_item)
+                {
+                    fprintf(stderr, "MAP: malloc failed\n");
+                    return false;
+                }
+                hc->dir_list.arr[hc->dir_list.size++] = dir_item;
+            }
+            break;
+        }
+        case HC_IMPORT_MODULES:
+        {
+            const struct json_array_s *value = item->value->payload;
+            // allocated even when empty, a hermit without imports has a list
+            if (!list_reserve(&hc->import_list, value->length + 1))
+            {
+                return false;
+            }
+            for (const struct json_array_element_s *aitem = value->start; aitem != NULL; aitem = aitem->next)
+            {
+                if (aitem->value->type != json_type_string)
+                {
+                    fprintf(stderr, "IMPORT_MODULES must be an array of strings\n");
+                    return false;
+                }
+                const struct json_string_s *string = aitem->value->payload;
+                char *module = config_strdup(hc, string->string, string->string_size);
+                if (!module || !list_push(&hc->import_list, module))
+                {
+                    fprintf(stderr, "IMPORT_MODULES: malloc failed\n");
+                    return false;
+                }
+            }
+            break;
+        }
+        case HC_ENV_PWD_IS_HOST_CWD:
+            if (!config_push_host_cwd(hc))
+            {
+                return false;
+            }
+            break;
+        case HC_ENV_EXE_NAME_IS_HOST_EXE_NAME:
+            if (!config_push_host_exe_name(hc))
+            {
+                return false;
+            }
+            break;
+        case HC_ENV:
+        {
+            const struct json_array_s *value = item->value->payload;
+            if (!list_reserve(&hc->env_list, hc->env_list.size + value->length + 1))
+            {
+                fprintf(stderr, "ENV: list_reserve failed\n");
+                return false;
+            }
+            for (const struct json_array_element_s *aitem = value->start; aitem != NULL; aitem = aitem->next)
+            {
+                if (aitem->value->type != json_type_string)
+                {
+                    fprintf(stderr, "ENV must be an array of strings\n");
+                    return false;
+                }
+                const struct json_string_s *string = aitem->value->payload;
+                if (!validate_env_str(string->string))
+                {
+                    fprintf(stderr, "ENV: parse env string failed: expect \"key=value\", "
+                                    "got \"%s\"\n",
+                            string->string);
+                    return false;
+                }
+                char *env_item = config_strdup(hc, string->string, string->string_size);
+                if (!env_item)
+                {
+                    fprintf(stderr, "ENV: malloc failed\n");
+                    return false;
+                }
+                hc->env_list.arr[hc->env_list.size++] = env_item;
+            }
+            break;
+        }
+        case HC_ENTRYPOINT:
+        {
+            const struct json_string_s *value = item->value->payload;
+            if (value->string_size == 0)
+            {
+                break;
+            }
+            if (!(hc->func_name = config_strdup(hc, value->string, value->string_size)))
+            {
+                fprintf(stderr, "ENTRYPOINT: malloc failed\n");
+                return false;
+            }
+            break;
+        }
+        case HC_SNAPSHOT:
+        {
+            const struct json_string_s *value = item->value->payload;
+            if (!(config->snapshot_export = config_strdup(hc, value->string, value->string_size)))
+            {
+                fprintf(stderr, "SNAPSHOT: malloc failed\n");
+                return false;
+            }
+            break;
+        }
+        case HC_RUNTIME:
+        {
+            const struct json_string_s *value = item->value->payload;
+            if (!parse_runtime(value->string, &config->runtime))
+            {
+                fprintf(stderr, "RUNTIME: unknown runtime \"%s\"\n", value->string);
+                return false;
+            }
+            break;
+        }
+        case HC_JIT_CODE_CACHE_SIZE:
+        {
+            const struct json_number_s *value = item->value->payload;
+            if (!parse_u32(value->number, &config->jit_code_cache_size))
+            {
+                fprintf(stderr, "JIT_CODE_CACHE_SIZE: invalid size %s\n", value->number);
+                return false;
+            }
+            break;
+        }
+        case HC_STACK:
+        case HC_HEAP:
+        case HC_MAX_MEMORY_PAGES:
+        case HC_HEAP_POOL:
+        {
+            const struct json_number_s *value = item->value->payload;
+            uint32_t *size = config_index == HC_STACK ? &config->stack_size : config_index == HC_HEAP ? &config->heap_size : config_index == HC_HEAP_POOL ? &config->heap_pool_size : &config->max_memory_pages;
+            if (!parse_u32(value->number, size) || (config_index == HC_MAX_MEMORY_PAGES && *size > HERMIT_WASM_MAX_PAGES))
+            {
+                fprintf(stderr, "%s: invalid size %s\n", name->string, value->number);
+                return false;
+            }
+            break;
+        }
+        case HC_LLVM_JIT_OPT_LEVEL:
+        case HC_LLVM_JIT_SIZE_LEVEL:
+        {
+            const struct json_number_s *value = item->value->payload;
+            uint32_t level;
+            if (!parse_u32(value->number, &level) || level < 1 || level > 3)
+            {
+                fprintf(stderr, "%s: expected a level from 1 to 3, got %s\n", name->string, value->number);
+                return false;
+            }
+            if (config_index == HC_LLVM_JIT_OPT_LEVEL)
+            {
+                config->llvm_jit_opt_level = level;
+            }
+            else
+            {
+                config->llvm_jit_size_level = level;
+            }
+            break;
+        }
+        case HC_CACHE:
+            hc->use_cache = true;
+            break;
+        case HC_TRUSTED:
+            config->disable_bounds_checks = true;
+            break;
+        case HC_FAST_EXIT:
+            config->fast_exit = true;
+            break;
+        case HC_HUGEPAGES:
+            config->hugepages = true;
+            break;
+        case HC_AOT_SEGUE:
+            config->aot_segue = true;
+            break;
+        case HC_SIMD:
+            config->uses_simd = true;
+            break;
+        case HC_PGO_TRAIN:
+            // the output path is only known in main
+            config->pgo_profile = "";
+            break;
+        case HC_WASM_SHA256:
+        {
+            const struct json_string_s *value = item->value->payload;
+            if (!is_sha256_hex(value->string))
+            {
+                fprintf(stderr, "WASM_SHA256: expected a hex sha256 digest\n");
+                return false;
+            }
+            if (!(config->wasm_sha256 = config_strdup(hc, value->string, value->string_size)))
+            {
+                fprintf(stderr, "WASM_SHA256: malloc failed\n");
+                return false;
+            }
+            break;
+        }
+        case HC_UNKNOWN:
+        case HC_NET:
+        case HC_ARGV:
+            break;
+        }
+        if (debug)
+        {
+            fprintf(stderr, "hermit-base: %s key: %.*s\n", ((config_index != HC_UNKNOWN) ? "found" : "unknown"), (int)name->string_size, name->string);
+        }
+    }
+    return true;
+}
+
+// hermit.cfg, the flat form of hermit.json the packer writes next to it and
+// that is used in place. Offsets are from the start of the blob, strings are
+// NUL terminated and lists are arrays of string offsets.
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t runtime;
+    uint32_t jit_code_cache_size;
+    uint32_t llvm_jit_opt_level;
+    uint32_t llvm_jit_size_level;
+    uint32_t map_count;
+    uint32_t map;
+    uint32_t env_count;
+    uint32_t env;
+    // optional strings, 0 when unset
+    uint32_t entrypoint;
+    uint32_t snapshot;
+    uint32_t wasm_sha256;
+    uint32_t import_count;
+    uint32_t imports;
+    // 0 keeps the default
+    uint32_t stack_size;
+    uint32_t heap_size;
+    uint32_t max_memory_pages;
+    uint32_t heap_pool_size;
+} hermit_config_blob;
+
+#define HERMIT_CFG_VERSION 4
+
+enum
+{
+    HERMIT_CFG_ENV_PWD_IS_HOST_CWD = 1 << 0,
+    HERMIT_CFG_ENV_EXE_NAME_IS_HOST_EXE_NAME = 1 << 1,
+    HERMIT_CFG_CACHE = 1 << 2,
+    HERMIT_CFG_TRUSTED = 1 << 3,
+    HERMIT_CFG_AOT_SEGUE = 1 << 4,
+    HERMIT_CFG_SIMD = 1 << 5,
+    HERMIT_CFG_PGO_TRAIN = 1 << 6,
+    HERMIT_CFG_FAST_EXIT = 1 << 7,
+    HERMIT_CFG_HUGEPAGES = 1 << 8,
+    // IMPORT_MODULES is the complete list, even when it is empty
+    HERMIT_CFG_IMPORT_MODULES_KNOWN = 1 << 9
+};
+
+// a string of the blob, NULL if the offset is out of bounds or unterminated
+static char *blob_string(uint8_t *blob, const uint32_t size, const uint32_t offset)
+{
+    if (offset >= size || memchr(blob + offset, '\0', size - offset) == NULL)
+    {
+        return NULL;
+    }
+    return (char *)blob + offset;
+}
+
+// points the entries of l at a list of strings of the blob
+static bool blob_strings(uint8_t *blob, const uint32_t size, const uint32_t count, const uint32_t offset, list *l)
+{
+    if (offset % sizeof(uint32_t) != 0 || offset > size || count > (size - offset) / sizeof(uint32_t) || !list_reserve(l, l->size + count + 2))
+    {
+        return false;
+    }
+    const uint32_t *offsets = (const uint32_t *)(blob + offset);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!(l->arr[l->size++] = blob_string(blob, size, offsets[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool load_hermit_config_blob(uint8_t *blob, const uint32_t size, hermit_config *hc)
+{
+    wamr_config *config = &hc->wamr;
+    const hermit_config_blob *header = (const hermit_config_blob *)blob;
+    if (size < sizeof(*header) || memcmp(header->magic, "HCFG", sizeof(header->magic)) != 0 || header->version != HERMIT_CFG_VERSION || header->size != size)
+    {
+        fprintf(stderr, "error hermit.cfg is not a hermit config\n");
+        return false;
+    }
+    if (!blob_strings(blob, size, header->map_count, header->map, &hc->dir_list))
+    {
+        fprintf(stderr, "error hermit.cfg has an invalid MAP\n");
+        return false;
+    }
+    if (!blob_strings(blob, size, header->env_count, header->env, &hc->env_list))
+    {
+        fprintf(stderr, "error hermit.cfg has an invalid ENV\n");
+        return false;
+    }
+    if ((header->import_count > 0 || (header->flags & HERMIT_CFG_IMPORT_MODULES_KNOWN)) && !blob_strings(blob, size, header->import_count, header->imports, &hc->import_list))
+    {
+        fprintf(stderr, "error hermit.cfg has invalid IMPORT_MODULES\n");
+        return false;
+    }
+    for (uint32_t i = 0; i < hc->env_list.size; i++)
+    {
+        if (!validate_env_str(hc->env_list.arr[i]))
+        {
+            fprintf(stderr, "ENV: parse env string failed: expect \"key=value\", got \"%s\"\n", hc->env_list.arr[i]);
+            return false;
+        }
+    }
+    if ((header->flags & HERMIT_CFG_ENV_PWD_IS_HOST_CWD) && !config_push_host_cwd(hc))
+    {
+        return false;
+    }
+    if ((header->flags & HERMIT_CFG_ENV_EXE_NAME_IS_HOST_EXE_NAME) && !config_push_host_exe_name(hc))
+    {
+        return false;
+    }
+    if ((header->entrypoint && !(hc->func_name = blob_string(blob, size, header->entrypoint))) || (header->snapshot && !(config->snapshot_export = blob_string(blob, size, header->snapshot))) || (header->wasm_sha256 && !(config->wasm_sha256 = blob_string(blob, size, header->wasm_sha256))))
+    {
+        fprintf(stderr, "error hermit.cfg has an invalid string\n");
+        return false;
+    }
+    if (config->wasm_sha256 && !is_sha256_hex(config->wasm_sha256))
+    {
+        fprintf(stderr, "WASM_SHA256: expected a hex sha256 digest\n");
+        return false;
+    }
+    // an empty ENTRYPOINT means main, as in hermit.json
+    if (hc->func_name && hc->func_name[0] == '\0')
+    {
+        hc->func_name = NULL;
+    }
+    if (header->runtime > HERMIT_RUNTIME_MULTI_TIER)
+    {
+        fprintf(stderr, "RUNTIME: unknown runtime %u\n", header->runtime);
+        return false;
+    }
+    if (header->llvm_jit_opt_level > 3 || header->llvm_jit_size_level > 3)
+    {
+        fprintf(stderr, "LLVM_JIT_OPT_LEVEL/LLVM_JIT_SIZE_LEVEL: expected a level from 1 to 3\n");
+        return false;
+    }
+    if (header->max_memory_pages > HERMIT_WASM_MAX_PAGES)
+    {
+        fprintf(stderr, "MAX_MEMORY: more than 4GB\n");
+        return false;
+    }
+    config->runtime = header->runtime;
+    config->stack_size = header->stack_size;
+    config->heap_size = header->heap_size;
+    config->max_memory_pages = header->max_memory_pages;
+    config->heap_pool_size = header->heap_pool_size;
+    config->jit_code_cache_size = header->jit_code_cache_size;
+    config->llvm_jit_opt_level = header->llvm_jit_opt_level;
+    config->llvm_jit_size_level = header->llvm_jit_size_level;
+    hc->use_cache = header->flags & HERMIT_CFG_CACHE;
+    config->disable_bounds_checks = header->flags & HERMIT_CFG_TRUSTED;
+    config->fast_exit = header->flags & HERMIT_CFG_FAST_EXIT;
+    config->hugepages = header->flags & HERMIT_CFG_HUGEPAGES;
+    config->aot_segue = header->flags & HERMIT_CFG_AOT_SEGUE;
+    config->uses_simd = header->flags & HERMIT_CFG_SIMD;
+    // the output path is only known in main
+    config->pgo_profile = header->flags & HERMIT_CFG_PGO_TRAIN ? "" : NULL;
+    return true;
+}
+
+// hermit.cfg, or hermit.json when there is no usable hermit.cfg
+static bool load_hermit_config_entries(hermit_config *hc)
+{
+    uint32_t size;
+    uint8_t *blob = hermit_zip_map("hermit.cfg", &size, false);
+    if (blob == NULL)
+    {
+        return load_hermit_config_json("hermit.json", hc);
+    }
+    // packed by another hermit.com version, hermit.json has the same settings
+    const hermit_config_blob *header = (const hermit_config_blob *)blob;
+    if (size < sizeof(*header) || header->version != HERMIT_CFG_VERSION)
+    {
+        hermit_zip_unmap(blob, size);
+        return load_hermit_config_json("hermit.json", hc);
+    }
+    if (getenv("HERMIT_DEBUG_BASE") != NULL)
+    {
+        fprintf(stderr, "hermit-base: using hermit.cfg\n");
+    }
+    // the strings point into the mapping, it is unmapped with the config
+    hc->blob = blob;
+    hc->blob_size = size;
+    return load_hermit_config_blob(blob, size, hc);
+}
+
+// a size from the environment, false if it is set but invalid or above max
+static bool env_size(const char *name, const uint64_t max, uint64_t *size)
+{
+    const char *value = getenv(name);
+    if (value != NULL && (!parse_size(value, size) || *size > max))
+    {
+        fprintf(stderr, "%s: invalid size \"%s\"\n", name, value);
+        return false;
+    }
+    return true;
+}
+
+// HERMIT_STACK, HERMIT_HEAP, HERMIT_MAX_MEMORY and HERMIT_HEAP_POOL take the
+// sizes the directives take and HERMIT_HUGEPAGES=1/0 turns HUGEPAGES on or
+// off, to tune a hermit without repacking it
+static bool load_memory_overrides(wamr_config *config)
+{
+    uint64_t stack_size = config->stack_size;
+    uint64_t heap_size = config->heap_size;
+    uint64_t max_memory = (uint64_t)config->max_memory_pages * HERMIT_WASM_PAGE_SIZE;
+    uint64_t heap_pool_size = config->heap_pool_size;
+    if (!env_size("HERMIT_STACK", UINT32_MAX, &stack_size) || !env_size("HERMIT_HEAP", UINT32_MAX, &heap_size) || !env_size("HERMIT_MAX_MEMORY", (uint64_t)HERMIT_WASM_MAX_PAGES * HERMIT_WASM_PAGE_SIZE, &max_memory) || !env_size("HERMIT_HEAP_POOL", UINT32_MAX, &heap_pool_size))
+    {
+        return false;
+    }
+    if (max_memory % HERMIT_WASM_PAGE_SIZE != 0)
+    {
+        fprintf(stderr, "HERMIT_MAX_MEMORY: not a multiple of the 64K Wasm page size\n");
+        return false;
+    }
+    config->stack_size = stack_size;
+    config->heap_size = heap_size;
+    config->max_memory_pages = max_memory / HERMIT_WASM_PAGE_SIZE;
+    config->heap_pool_size = heap_pool_size;
+    const char *hugepages = getenv("HERMIT_HUGEPAGES");
+    if (hugepages != NULL)
+    {
+        config->hugepages = strcmp(hugepages, "0") != 0;
+    }
+    return true;
+}
+
+bool load_env_overrides(hermit_config *hc)
+{
+    wamr_config *config = &hc->wamr;
+
+    // compare segue against plain addressing without repacking
+    const char *segue = getenv("HERMIT_SEGUE");
+    config->disable_segue = segue != NULL && strcmp(segue, "0") == 0;
+
+    // the native code cache is opt-in, either by the Hermitfile or by
+    // pointing HERMIT_CACHE_DIR somewhere
+    char cache_dir[PATH_MAX];
+    if ((hc->use_cache || getenv("HERMIT_CACHE_DIR") != NULL) && hermit_cache_default_dir(cache_dir, sizeof(cache_dir)) && !(config->cache_dir = config_strdup(hc, cache_dir, strlen(cache_dir))))
+    {
+        return false;
+    }
+
+    // training hermits write the profile of their run for wamrc
+    // --use-prof-file, see pgo_hermit.sh
+    if (config->pgo_profile != NULL)
+    {
+        const char *pgo_profile = getenv("HERMIT_PGO_PROFILE");
+        config->pgo_profile = pgo_profile != NULL ? pgo_profile : "hermit.profraw";
+    }
+
+    // HERMIT_FAST_EXIT=1/0 turns FAST_EXIT on or off without repacking
+    const char *fast_exit = getenv("HERMIT_FAST_EXIT");
+    if (fast_exit != NULL)
+    {
+        config->fast_exit = strcmp(fast_exit, "0") != 0;
+    }
+
+    if (!load_memory_overrides(config))
+    {
+        return false;
+    }
+
+    // allow comparing engines without repacking the hermit
+    const char *runtime_override = getenv("HERMIT_RUNTIME");
+    if (runtime_override != NULL && !parse_runtime(runtime_override, &config->runtime))
+    {
+        fprintf(stderr, "HERMIT_RUNTIME: unknown runtime \"%s\"\n", runtime_override);
+        return false;
+    }
+    return true;
+}
+
+bool load_hermit_config(hermit_config *hc)
+{
+    if (!load_hermit_config_entries(hc))
+    {
+        return false;
+    }
+    // no list when the packer didn't record the imports
+    if (hc->import_list.arr != NULL)
+    {
+        hc->wamr.import_modules = (const char *const *)hc->import_list.arr;
+        hc->wamr.import_module_count = hc->import_list.size;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "wamr.h"
+
+#define defer(fn) __attribute__((cleanup(fn)))
+
+void cleanup_free(void *p);
+#define defer_free defer(cleanup_free)
+
+typedef struct
+{
+    char **arr;
+    uint32_t max;
+    uint32_t size;
+} list;
+
+// the configuration of the hermit, its strings either point into the mapped
+// hermit.cfg or are owned by `strings`
+typedef struct
+{
+    list dir_list;
+    list env_list;
+    list import_list;
+    list strings;
+    // hermit.cfg, mapped until the config is cleaned up
+    uint8_t *blob;
+    uint32_t blob_size;
+    const char *func_name;
+    bool use_cache;
+    wamr_config wamr;
+} hermit_config;
+
+void cleanup_hermit_config(hermit_config *hc);
+#define defer_hermit_config defer(cleanup_hermit_config)
+
+bool parse_runtime(const char *name, hermit_runtime *runtime);
+
+// parses a byte size with an optional K, M or G suffix, as the Hermitfile
+// takes them
+bool parse_size(const char *str, uint64_t *size);
+
+// the HERMIT_* environment variables that tune a hermit without repacking
+// it, applied on top of its config
+bool load_env_overrides(hermit_config *hc);
+
+// hermit.cfg is used in place from the executable, hermits packed before it
+// existed only have hermit.json
+bool load_hermit_config(hermit_config *hc);
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// the memory instance has no public API, the interpreter and AOT share the
+// instance layout
+#include "wasm_runtime.h"
+
+#include "hugepages.h"
+
+#define HUGE_PAGE_SIZE ((uintptr_t)2 << 20)
+
+// "never" in /sys/kernel/mm/transparent_hugepage/enabled turns madvise into
+// a no-op that still succeeds
+static bool thp_disabled(void)
+{
+    char mode[64] = {0};
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    const bool read = fgets(mode, sizeof(mode), file) != NULL;
+    fclose(file);
+    return read && strstr(mode, "[never]") != NULL;
+}
+
+bool hermit_hugepages_advise(wasm_module_inst_t module_inst)
+{
+    const WASMModuleInstance *inst = (const WASMModuleInstance *)module_inst;
+    if (inst->memory_count == 0)
+    {
+        return true;
+    }
+    const WASMMemoryInstance *memory = inst->memories[0];
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+    // the memory is a reservation it grows into in place, advising all of it
+    // now covers the pages it grows into later
+    const uint64_t size = (uint64_t)memory->num_bytes_per_page * memory->max_page_count;
+#else
+    // the memory moves when it grows, only its current pages can be advised
+    const uint64_t size = memory->memory_data_size;
+#endif
+    // huge pages can only back whole aligned 2MB ranges, the kernel places
+    // the memory, so the unaligned head and tail stay on 4KB pages
+    const uintptr_t start = ((uintptr_t)memory->memory_data + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    const uintptr_t end = ((uintptr_t)memory->memory_data + size) & ~(HUGE_PAGE_SIZE - 1);
+    if (end <= start)
+    {
+        return true;
+    }
+#ifdef MADV_HUGEPAGE
+    if (thp_disabled())
+    {
+        fprintf(stderr, "hermit-base: transparent huge pages are disabled, HUGEPAGES has no effect\n");
+        return false;
+    }
+    if (madvise((void *)start, end - start, MADV_HUGEPAGE) != 0)
+    {
+        fprintf(stderr, "hermit-base: HUGEPAGES: madvise failed: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "hermit-base: HUGEPAGES is not supported on this platform\n");
+    return false;
+#endif
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+#include <stdbool.h>
+
+#include "wasm_export.h"
+
+// Hermitfile `HUGEPAGES`: asks the kernel to back the 2MB aligned part of
+// the instance's linear memory with transparent huge pages. Returns false,
+// after saying why, if the kernel won't, the memory then stays on 4KB pages.
+bool hermit_hugepages_advise(wasm_module_inst_t module_inst);
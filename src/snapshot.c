@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+// globals have no public API, the interpreter and AOT share the instance
+// layout
+#include "wasm_runtime.h"
+
+#include "snapshot.h"
+#include "stats.h"
+
+#define SNAPSHOT_MAGIC "HSNP"
+#define SNAPSHOT_VERSION 2
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    // hex digest of the main.wasm the snapshot was taken of
+    char wasm_sha256[64];
+    // Wasm_Module_Bytecode or Wasm_Module_AoT, the interpreters and AOT code
+    // lay out globals differently
+    uint32_t module_type;
+    // zero, keeps memory_size aligned
+    uint32_t reserved;
+    uint32_t memory_pages;
+    uint32_t globals_size;
+    // bytes of memory stored, trailing zero bytes are left out
+    uint64_t memory_size;
+} snapshot_header;
+
+bool hermit_snapshot_capture(wasm_module_inst_t module_inst, const char *wasm_sha256, const char *path)
+{
+    const WASMModuleInstance *inst = (const WASMModuleInstance *)module_inst;
+    snapshot_header header = {0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    if (wasm_sha256 == NULL)
+    {
+        fprintf(stderr, "hermit-base: the hermit has no wasm_sha256 to tie the snapshot to\n");
+        return false;
+    }
+    memcpy(header.wasm_sha256, wasm_sha256, sizeof(header.wasm_sha256));
+    header.module_type = inst->module_type;
+    header.globals_size = inst->global_data_size;
+    const uint8_t *memory = NULL;
+    if (inst->memory_count > 0)
+    {
+        const WASMMemoryInstance *memory_inst = inst->memories[0];
+        memory = memory_inst->memory_data;
+        header.memory_pages = memory_inst->cur_page_count;
+        header.memory_size = (uint64_t)memory_inst->num_bytes_per_page * memory_inst->cur_page_count;
+        while (header.memory_size > 0 && memory[header.memory_size - 1] == 0)
+        {
+            header.memory_size--;
+        }
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "hermit-base: cannot create snapshot %s\n", path);
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(inst->global_data, 1, header.globals_size, file) == header.globals_size && fwrite(memory, 1, header.memory_size, file) == header.memory_size;
+    written = fclose(file) == 0 && written;
+    if (!written)
+    {
+        fprintf(stderr, "hermit-base: error writing snapshot %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// zeroes [start, end) without writing to pages that are already zero, as
+// that would allocate them
+static void clear_dirty_pages(uint8_t *start, uint8_t *end)
+{
+    while (start < end)
+    {
+        uint8_t *page_end = start + 4096 - ((uintptr_t)start & 4095);
+        if (page_end > end)
+        {
+            page_end = end;
+        }
+        for (const uint8_t *p = start; p < page_end; p++)
+        {
+            if (*p != 0)
+            {
+                memset(start, 0, page_end - start);
+                break;
+            }
+        }
+        start = page_end;
+    }
+}
+
+bool hermit_snapshot_restore(wasm_module_inst_t module_inst, const char *wasm_sha256, const uint8_t *snapshot, const uint32_t size)
+{
+    WASMModuleInstance *inst = (WASMModuleInstance *)module_inst;
+    snapshot_header header;
+    if (size < sizeof(header))
+    {
+        fprintf(stderr, "hermit-base: snapshot is truncated\n");
+        return false;
+    }
+    memcpy(&header, snapshot, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION)
+    {
+        fprintf(stderr, "hermit-base: unsupported snapshot format\n");
+        return false;
+    }
+    if (wasm_sha256 == NULL || memcmp(header.wasm_sha256, wasm_sha256, sizeof(header.wasm_sha256)) != 0)
+    {
+        fprintf(stderr, "hermit-base: snapshot was taken of a different main.wasm\n");
+        return false;
+    }
+    if (header.module_type != inst->module_type)
+    {
+        fprintf(stderr, "hermit-base: snapshot was taken running %s\n", header.module_type == Wasm_Module_AoT ? "main.aot" : "main.wasm");
+        return false;
+    }
+    const WASMMemoryInstance *memory_inst = inst->memory_count > 0 ? inst->memories[0] : NULL;
+    const uint32_t cur_pages = memory_inst != NULL ? memory_inst->cur_page_count : 0;
+    const bool matches = header.globals_size == inst->global_data_size &&
+                         header.globals_size <= size - sizeof(header) &&
+                         header.memory_size <= size - sizeof(header) - header.globals_size &&
+                         header.memory_pages >= cur_pages &&
+                         (memory_inst != NULL ? header.memory_size <= (uint64_t)memory_inst->num_bytes_per_page * header.memory_pages : header.memory_pages == 0);
+    if (!matches)
+    {
+        fprintf(stderr, "hermit-base: snapshot doesn't match the module\n");
+        return false;
+    }
+
+    if (memory_inst != NULL)
+    {
+        const uint64_t fresh_size = (uint64_t)memory_inst->num_bytes_per_page * cur_pages;
+        if (header.memory_pages > cur_pages && !hermit_stats_grow_uncounted(module_inst, header.memory_pages - cur_pages))
+        {
+            fprintf(stderr, "hermit-base: cannot grow memory to %u pages for the snapshot\n", header.memory_pages);
+            return false;
+        }
+        // growing may have moved the memory
+        memory_inst = inst->memories[0];
+        memcpy(memory_inst->memory_data, snapshot + sizeof(header) + header.globals_size, header.memory_size);
+        // grown pages are zero, the initial ones may hold data segments
+        if (fresh_size > header.memory_size)
+        {
+            clear_dirty_pages(memory_inst->memory_data + header.memory_size, memory_inst->memory_data + fresh_size);
+        }
+    }
+    memcpy(inst->global_data, snapshot + sizeof(header), header.globals_size);
+    return true;
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "wasm_export.h"
+
+// Hermitfile `SNAPSHOT`: the linear memory and globals an instance has after
+// its init export ran, restored into fresh instances instead of running the
+// export again
+
+// writes the state of module_inst to path
+bool hermit_snapshot_capture(wasm_module_inst_t module_inst, const char *wasm_sha256, const char *path);
+
+// overwrites the state of a freshly instantiated module_inst, leaving it
+// untouched if the snapshot doesn't belong to it
+bool hermit_snapshot_restore(wasm_module_inst_t module_inst, const char *wasm_sha256, const uint8_t *snapshot, const uint32_t size);
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// the memory instance and the consumption of the module and instance have no
+// public API, the interpreter and AOT share the instance layout
+#include "wasm_runtime.h"
+#if WASM_ENABLE_MEMORY_PROFILING != 0 && WASM_ENABLE_AOT != 0
+#include "aot_runtime.h"
+#endif
+
+#include "stats.h"
+
+static uint32_t memory_grows;
+
+// every memory.grow of the interpreters, JITs and AOT code goes through
+// wasm_enlarge_memory, which the link wraps, see CMakeLists.txt
+bool __real_wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count);
+
+bool __wrap_wasm_enlarge_memory(WASMModuleInstance *module, uint32 inc_page_count)
+{
+    memory_grows++;
+    return __real_wasm_enlarge_memory(module, inc_page_count);
+}
+
+bool hermit_stats_grow_uncounted(wasm_module_inst_t module_inst, const uint32_t inc_page_count)
+{
+    return __real_wasm_enlarge_memory((WASMModuleInstance *)module_inst, inc_page_count);
+}
+
+// bytes of the module's and the instance's runtime structures, the numbers
+// wasm_runtime_dump_mem_consumption prints. Only builds with memory
+// profiling count them.
+static bool module_consumption(wasm_module_t module, wasm_module_inst_t module_inst, uint64_t *module_bytes, uint64_t *instance_bytes)
+{
+#if WASM_ENABLE_MEMORY_PROFILING != 0
+#if WASM_ENABLE_INTERP != 0
+    if (module_inst->module_type == Wasm_Module_Bytecode)
+    {
+        WASMModuleMemConsumption module_mem;
+        WASMModuleInstMemConsumption inst_mem;
+        wasm_get_module_mem_consumption((WASMModule *)module, &module_mem);
+        wasm_get_module_inst_mem_consumption((WASMModuleInstance *)module_inst, &inst_mem);
+        *module_bytes = module_mem.total_size;
+        *instance_bytes = inst_mem.total_size;
+        return true;
+    }
+#endif
+#if WASM_ENABLE_AOT != 0
+    if (module_inst->module_type == Wasm_Module_AoT)
+    {
+        AOTModuleMemConsumption module_mem;
+        AOTModuleInstMemConsumption inst_mem;
+        aot_get_module_mem_consumption((AOTModule *)module, &module_mem);
+        aot_get_module_inst_mem_consumption((AOTModuleInstance *)module_inst, &inst_mem);
+        *module_bytes = module_mem.total_size;
+        *instance_bytes = inst_mem.total_size;
+        return true;
+    }
+#endif
+#else
+    (void)module;
+    (void)module_inst;
+    (void)module_bytes;
+    (void)instance_bytes;
+#endif
+    return false;
+}
+
+// a field this build or mode can't measure is null rather than a 0 that
+// reads like a measurement
+static void print_field(FILE *out, const char *name, const bool known, const uint64_t value)
+{
+    if (known)
+    {
+        fprintf(out, "\"%s\":%llu,", name, (unsigned long long)value);
+    }
+    else
+    {
+        fprintf(out, "\"%s\":null,", name);
+    }
+}
+
+void hermit_stats_report(wasm_module_t module, wasm_module_inst_t module_inst)
+{
+    const uint32_t grows = memory_grows;
+    // hermit-bench runs many guests in one process
+    memory_grows = 0;
+    const char *dest = getenv("HERMIT_STATS");
+    if (dest == NULL || dest[0] == '\0' || strcmp(dest, "0") == 0)
+    {
+        return;
+    }
+
+    // memory never shrinks, its size now is its peak
+    const WASMModuleInstance *inst = (const WASMModuleInstance *)module_inst;
+    const WASMMemoryInstance *memory = inst->memory_count > 0 ? inst->memories[0] : NULL;
+    uint64_t module_bytes = 0, instance_bytes = 0;
+    const bool profiled = module_consumption(module, module_inst, &module_bytes, &instance_bytes);
+    // only known for HEAP_POOL, malloc has no such counters
+    mem_alloc_info_t heap = {0};
+    const bool pool = wasm_runtime_get_mem_alloc_info(&heap);
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+
+    const bool to_stderr = strcmp(dest, "1") == 0;
+    FILE *out = to_stderr ? stderr : fopen(dest, "a");
+    if (out == NULL)
+    {
+        fprintf(stderr, "HERMIT_STATS: failed to open %s\n", dest);
+        return;
+    }
+    fprintf(out, "{\"hermit_stats\":2,");
+    print_field(out, "memory_pages", memory != NULL, memory ? memory->cur_page_count : 0);
+    print_field(out, "memory_max_pages", memory != NULL, memory ? memory->max_page_count : 0);
+    print_field(out, "memory_page_size", memory != NULL, memory ? memory->num_bytes_per_page : 0);
+    fprintf(out, "\"memory_grows\":%u,", grows);
+    print_field(out, "module_bytes", profiled, module_bytes);
+    print_field(out, "instance_bytes", profiled, instance_bytes);
+    print_field(out, "heap_pool_bytes", pool, heap.total_size);
+    print_field(out, "heap_pool_used_bytes", pool, heap.total_size - heap.total_free_size);
+    print_field(out, "heap_pool_peak_bytes", pool, heap.highmark_size);
+    // KiB on Linux
+    fprintf(out, "\"max_rss_kib\":%ld}\n", usage.ru_maxrss);
+    if (!to_stderr)
+    {
+        fclose(out);
+    }
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include "wasm_export.h"
+
+// HERMIT_STATS: how much memory the hermit used, one JSON line per run
+// written to stderr when set to 1, appended to the file it names otherwise
+
+// writes the line for the instance the guest ran in, before it is freed
+void hermit_stats_report(wasm_module_t module, wasm_module_inst_t module_inst);
+
+// grows linear memory without counting it as a memory.grow of the guest, for
+// grows the hermit makes itself such as restoring a snapshot
+bool hermit_stats_grow_uncounted(wasm_module_inst_t module_inst, const uint32_t inc_page_count);
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_MAX_PHASES 32
+
+static struct
+{
+    bool enabled;
+    // NULL when the phases are only read with hermit_trace_phases
+    const char *dest;
+    uint64_t start_ns;
+    uint64_t last_ns;
+    uint32_t count;
+    struct
+    {
+        const char *name;
+        uint64_t ns;
+    } phases[TRACE_MAX_PHASES];
+} trace;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// as early as the hermit's own code gets to run
+__attribute__((constructor(101))) static void trace_start(void)
+{
+    const char *dest = getenv("HERMIT_TRACE_STARTUP");
+    if (dest == NULL || dest[0] == '\0' || strcmp(dest, "0") == 0)
+    {
+        return;
+    }
+    trace.dest = dest;
+    hermit_trace_restart();
+}
+
+void hermit_trace_phase(const char *name)
+{
+    if (!trace.enabled || trace.count == TRACE_MAX_PHASES)
+    {
+        return;
+    }
+    const uint64_t now = now_ns();
+    trace.phases[trace.count].name = name;
+    trace.phases[trace.count].ns = now - trace.last_ns;
+    trace.count++;
+    trace.last_ns = now;
+}
+
+void hermit_trace_report(void)
+{
+    if (trace.dest == NULL)
+    {
+        return;
+    }
+    const uint64_t total_ns = now_ns() - trace.start_ns;
+    const bool to_stderr = strcmp(trace.dest, "1") == 0;
+    FILE *out = to_stderr ? stderr : fopen(trace.dest, "a");
+    if (out == NULL)
+    {
+        fprintf(stderr, "HERMIT_TRACE_STARTUP: failed to open %s\n", trace.dest);
+        return;
+    }
+    fputs("hermit-trace:", out);
+    for (uint32_t i = 0; i < trace.count; i++)
+    {
+        fprintf(out, " %s=%.3fms", trace.phases[i].name, trace.phases[i].ns / 1e6);
+    }
+    fprintf(out, " total=%.3fms\n", total_ns / 1e6);
+    if (!to_stderr)
+    {
+        fclose(out);
+    }
+}
+
+void hermit_trace_restart(void)
+{
+    trace.enabled = true;
+    trace.count = 0;
+    trace.start_ns = trace.last_ns = now_ns();
+}
+
+uint32_t hermit_trace_phases(const char **names, uint64_t *ns, const uint32_t max)
+{
+    for (uint32_t i = 0; i < trace.count && i < max; i++)
+    {
+        names[i] = trace.phases[i].name;
+        ns[i] = trace.phases[i].ns;
+    }
+    return trace.count;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+#include <stdint.h>
+
+// HERMIT_TRACE_STARTUP=1 prints how long each startup phase took to stderr
+// as one line per run, any other value is a file the line is appended to.
+// Times come from the monotonic clock and are measured from the hermit's
+// first constructor. Both calls are no-ops when tracing is off.
+
+// ends the phase running since the previous call (or process entry)
+void hermit_trace_phase(const char *name);
+
+// writes the phases recorded so far
+void hermit_trace_report(void);
+
+// turns tracing on and drops the phases recorded so far, for measuring
+// repeated runs in one process
+void hermit_trace_restart(void);
+
+// copies up to max of the phases recorded since the last restart, returns
+// how many were recorded
+uint32_t hermit_trace_phases(const char **names, uint64_t *ns, const uint32_t max);
@@ -14,11 +14,31 @@
 #include "bh_platform.h"
 #include "bh_read_file.h"
 #include "wasm_export.h"
+#include "cache.h"
+#include "hugepages.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
+#include "wamr.h"
+#include "zipmap.h"
+
+#if WASM_ENABLE_JIT != 0 && WASM_ENABLE_AOT != 0
+#include "aot_export.h"
+#endif
 
 #if BH_HAS_DLFCN
 #include <dlfcn.h>
 #endif
 
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+#include <sys/resource.h>
+#endif
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <sys/auxv.h>
+#endif
+
 static const void *
 app_instance_main(wasm_module_inst_t module_inst, int app_argc, char *app_argv[])
 {
@@ -198,10 +218,6 @@ moudle_destroyer(uint8 *buffer, uint32 size)
 }
 #endif /* WASM_ENABLE_MULTI_MODULE */
 
-#if WASM_ENABLE_GLOBAL_HEAP_POOL != 0
-static char global_heap_buf[WASM_GLOBAL_HEAP_SIZE] = {0};
-#endif
-
 #if WASM_ENABLE_STATIC_PGO != 0
 static void
 dump_pgo_prof_data(wasm_module_inst_t module_inst, const char *path)
@@ -244,36 +260,441 @@ dump_pgo_prof_data(wasm_module_inst_t module_inst, const char *path)
 }
 #endif
 
-int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[], const uint32_t dir_list_size, const char *env_list[], const uint32_t env_list_size, const char *func_name)
+typedef enum
+{
+    /* read with bh_read_file_to_buffer */
+    MODULE_BUF_HEAP,
+    /* executable copy of an XIP AOT file */
+    MODULE_BUF_XIP,
+    /* private mapping of a code cache entry */
+    MODULE_BUF_CACHE,
+    /* private mapping of a stored entry of the executable's zip */
+    MODULE_BUF_ZIP,
+    /* copy of a zip entry from hermit_zip_read */
+    MODULE_BUF_ZIP_COPY
+} module_buf_kind;
+
+static void
+release_module_buf(uint8 *buf, uint32 size, module_buf_kind kind)
+{
+    switch (kind)
+    {
+    case MODULE_BUF_HEAP:
+        wasm_runtime_free(buf);
+        break;
+    case MODULE_BUF_XIP:
+        os_munmap(buf, size);
+        break;
+    case MODULE_BUF_CACHE:
+        hermit_cache_unmap(buf, size);
+        break;
+    case MODULE_BUF_ZIP:
+        hermit_zip_unmap(buf, size);
+        break;
+    case MODULE_BUF_ZIP_COPY:
+        free(buf);
+        break;
+    }
+}
+
+#if WASM_ENABLE_AOT != 0
+/* /zip/ paths name entries of the zip hermit_zip_use picked, which isn't
+   always the one cosmopolitan serves at /zip/ */
+static bool
+file_exists(const char *file)
+{
+    if (strncmp(file, "/zip/", 5) == 0)
+        return hermit_zip_has(file + 5);
+    return access(file, F_OK) == 0;
+}
+#endif
+
+/* read a wasm or AOT file and load it, the buffer must outlive the module */
+static wasm_module_t
+load_module_file(const char *file, uint8 **p_buf, uint32 *p_size,
+                 module_buf_kind *p_kind, char *error_buf,
+                 uint32 error_buf_size)
+{
+    wasm_module_t module;
+    uint8 *buf;
+    uint32 size;
+    module_buf_kind kind = MODULE_BUF_HEAP;
+    bool xip = false;
+    const char *load_phase;
+
+    /* entries the packer stored uncompressed are mapped straight from the
+       executable, without inflating or copying them */
+    if (strncmp(file, "/zip/", 5) == 0
+        && (buf = hermit_zip_map(file + 5, &size, false)))
+    {
+        kind = MODULE_BUF_ZIP;
+#if WASM_ENABLE_AOT != 0
+        /* XIP images run in place, remap them where code goes */
+        if (wasm_runtime_is_xip_file(buf, size))
+        {
+            hermit_zip_unmap(buf, size);
+            if (!(buf = hermit_zip_map(file + 5, &size, true)))
+                kind = MODULE_BUF_HEAP;
+            else
+                xip = true;
+        }
+#endif
+    }
+
+    /* the other entries are read whole, from the same zip as the mapped
+       ones */
+    if (kind == MODULE_BUF_HEAP && strncmp(file, "/zip/", 5) == 0)
+    {
+        buf = hermit_zip_read(file + 5, &size);
+        kind = MODULE_BUF_ZIP_COPY;
+    }
+    /* load WASM byte buffer from WASM bin file */
+    else if (kind == MODULE_BUF_HEAP)
+        buf = (uint8 *)bh_read_file_to_buffer(file, &size);
+    if (!buf)
+    {
+        snprintf(error_buf, error_buf_size, "failed to read %s", file);
+        return NULL;
+    }
+
+#if WASM_ENABLE_AOT != 0
+    if ((kind == MODULE_BUF_HEAP || kind == MODULE_BUF_ZIP_COPY)
+        && wasm_runtime_is_xip_file(buf, size))
+    {
+        uint8 *wasm_file_mapped;
+        int map_prot = MMAP_PROT_READ | MMAP_PROT_WRITE;
+        int map_flags = MMAP_MAP_32BIT;
+
+        if (!(wasm_file_mapped =
+                  os_mmap(NULL, (uint32)size, map_prot, map_flags)))
+        {
+            snprintf(error_buf, error_buf_size, "mmap memory failed");
+            release_module_buf(buf, size, kind);
+            return NULL;
+        }
+
+        bh_memcpy_s(wasm_file_mapped, size, buf, size);
+        release_module_buf(buf, size, kind);
+        buf = wasm_file_mapped;
+        kind = MODULE_BUF_XIP;
+        xip = true;
+    }
+#endif
+
+    hermit_trace_phase("read");
+
+    /* AOT images are traced apart from bytecode, to tell which one ran */
+    load_phase = get_package_type(buf, size) == Wasm_Module_AoT ? "load_aot"
+                                                                 : "load";
+    /* load WASM module */
+    module = wasm_runtime_load(buf, size, error_buf, error_buf_size);
+    hermit_trace_phase(load_phase);
+    if (!module)
+    {
+        release_module_buf(buf, size, kind);
+        return NULL;
+    }
+
+    /* the loader may patch an XIP image, so it is only writable until the
+       load is done and never writable and executable at once */
+    if (xip && os_mprotect(buf, size, MMAP_PROT_READ | MMAP_PROT_EXEC) != 0)
+    {
+        snprintf(error_buf, error_buf_size, "mprotect memory failed");
+        wasm_runtime_unload(module);
+        release_module_buf(buf, size, kind);
+        return NULL;
+    }
+
+    *p_buf = buf;
+    *p_size = size;
+    *p_kind = kind;
+    return module;
+}
+
+/* Hermitfile `SNAPSHOT`: restore the state the init export left behind when
+   the hermit carries a snapshot of it, run the export otherwise */
+static bool
+init_instance(wasm_module_inst_t module_inst, const wamr_config *config)
+{
+    const char *exception;
+    uint8 *snapshot = NULL;
+    uint32 snapshot_size = 0;
+    module_buf_kind kind = MODULE_BUF_ZIP;
+    bool restored = false;
+
+    if (!config->snapshot_capture
+        && !(snapshot =
+                 hermit_zip_map("snapshot.bin", &snapshot_size, false)))
+    {
+        snapshot = hermit_zip_read("snapshot.bin", &snapshot_size);
+        kind = MODULE_BUF_ZIP_COPY;
+    }
+    if (snapshot)
+    {
+        restored = hermit_snapshot_restore(module_inst, config->wasm_sha256,
+                                           snapshot, snapshot_size);
+        release_module_buf(snapshot, snapshot_size, kind);
+        if (restored)
+            return true;
+        fprintf(stderr, "hermit-base: running %s instead of the snapshot\n",
+                config->snapshot_export);
+    }
+
+    wasm_application_execute_func(module_inst, config->snapshot_export, 0,
+                                  NULL);
+    if ((exception = wasm_runtime_get_exception(module_inst)))
+    {
+        printf("%s\n", exception);
+        return false;
+    }
+    if (config->snapshot_capture)
+        return hermit_snapshot_capture(module_inst, config->wasm_sha256,
+                                       config->snapshot_capture);
+    return true;
+}
+
+#if WASM_ENABLE_AOT != 0
+/* load native code compiled by an earlier run, NULL on a cache miss */
+static wasm_module_t
+load_module_cached(const char *cache_path, uint8 **p_buf, uint32 *p_size)
+{
+    wasm_module_t module;
+    uint8 *buf;
+    uint32 size;
+    char error_buf[128];
+
+    if (!(buf = hermit_cache_map(cache_path, &size)))
+        return NULL;
+    hermit_trace_phase("read");
+
+    module = wasm_runtime_load(buf, size, error_buf, sizeof(error_buf));
+    hermit_trace_phase("load_aot");
+    if (!module)
+    {
+        /* stale or foreign entry, it is replaced after this run */
+        fprintf(stderr, "hermit-base: ignoring %s: %s\n", cache_path,
+                error_buf);
+        hermit_cache_unmap(buf, size);
+        return NULL;
+    }
+
+    *p_buf = buf;
+    *p_size = size;
+    return module;
+}
+
+/* compile options compile_to_cache bakes into an image: software bounds
+   checks unless guard pages catch out of bounds accesses, and SIMD. Segue is
+   used when the host supports it. */
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+#define CACHE_BOUNDS_CHECKS 0
+#else
+#define CACHE_BOUNDS_CHECKS 1
+#endif
+#define CACHE_SIMD true
+
+/* names the options in the cache key, so builds and hosts that compile
+   differently never load each other's entries */
+static void
+get_cache_options(bool segue, char *options, size_t options_size)
+{
+    snprintf(options, options_size, "%s-%s-%s",
+             CACHE_BOUNDS_CHECKS ? "checked" : "guarded",
+             segue ? "segue" : "noseg", CACHE_SIMD ? "simd" : "nosimd");
+}
+#endif
+
+#if WASM_ENABLE_JIT != 0 && WASM_ENABLE_AOT != 0
+/* compile the module with the embedded LLVM and publish it to the cache */
+static void
+compile_to_cache(wasm_module_t module, const char *cache_path, bool segue)
+{
+    AOTCompOption option = { 0 };
+    aot_comp_data_t comp_data = NULL;
+    aot_comp_context_t comp_ctx = NULL;
+    char tmp_path[PATH_MAX];
+
+    /* same defaults as wamrc, tuned for the host CPU */
+    option.opt_level = 3;
+    option.size_level = 3;
+    option.output_format = AOT_FORMAT_FILE;
+    option.bounds_checks = CACHE_BOUNDS_CHECKS;
+    option.stack_bounds_checks = 2;
+    option.enable_simd = CACHE_SIMD;
+    /* all of i32/i64/f32/f64/v128 loads and stores, as wamrc --enable-segue */
+    option.segue_flags = segue ? 0x1F1F : 0;
+    option.enable_bulk_memory = true;
+    option.enable_aux_stack_check = true;
+
+    /* writers race on the final name only, each one has its own temp file */
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache_path,
+                 (int)getpid())
+        >= (int)sizeof(tmp_path))
+        return;
+
+    if (!(comp_data = aot_create_comp_data(module))
+        || !(comp_ctx = aot_create_comp_context(comp_data, &option))
+        || !aot_compile_wasm(comp_ctx)
+        || !aot_emit_aot_file(comp_ctx, comp_data, tmp_path))
+    {
+        fprintf(stderr, "hermit-base: caching native code failed: %s\n",
+                aot_get_last_error());
+        unlink(tmp_path);
+    }
+    else
+    {
+        hermit_cache_publish(tmp_path, cache_path);
+    }
+
+    if (comp_ctx)
+        aot_destroy_comp_context(comp_ctx);
+    if (comp_data)
+        aot_destroy_comp_data(comp_data);
+}
+#endif
+
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+/* linear memory is reserved up front, which a low ulimit -v can't fit */
+static void
+warn_address_space_limit(void)
+{
+    const rlim_t reserved = 8ULL * 1024 * 1024 * 1024;
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_AS, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY
+        && limit.rlim_cur < reserved)
+        fprintf(stderr,
+                "hermit-base: the address space limit (ulimit -v) is below "
+                "the 8GB reserved for guard page bounds checks\n");
+}
+#endif
+
+#if HERMIT_LIBC_BUILTIN != 0
+/* from WAMR's libc_builtin_wrapper.c, which hermit-base builds itself */
+uint32
+get_libc_builtin_export_apis(NativeSymbol **p_libc_builtin_apis);
+
+static bool
+imports_module(const wamr_config *config, const char *module_name)
+{
+    uint32 i;
+
+    /* hermits packed before IMPORT_MODULES get everything */
+    if (!config->import_modules)
+        return true;
+    for (i = 0; i < config->import_module_count; i++)
+        if (strcmp(config->import_modules[i], module_name) == 0)
+            return true;
+    return false;
+}
+
+/* WAMR is built without libc-builtin so wasm_runtime_full_init doesn't
+   sort its natives on every start, WASI guests never import them */
+static bool
+register_imported_natives(const wamr_config *config)
+{
+    NativeSymbol *symbols;
+    uint32 count;
+
+    if (!imports_module(config, "env"))
+        return true;
+    count = get_libc_builtin_export_apis(&symbols);
+    return wasm_runtime_register_natives("env", symbols, count);
+}
+#endif
+
+#if WASM_ENABLE_JIT != 0 || WASM_ENABLE_AOT != 0
+/* segue addressing keeps the linear memory base in GS, which needs the
+   FSGSBASE instructions and a kernel that allows them in user space, and a
+   runtime built to write GS at all (HERMIT_SEGUE in CMakeLists.txt) */
+static bool
+is_segue_supported(void)
+{
+#if defined(WASM_DISABLE_WRITE_GS_BASE) && WASM_DISABLE_WRITE_GS_BASE != 0
+    return false;
+#elif defined(__x86_64__) && defined(AT_HWCAP2)
+    const unsigned long hwcap2_fsgsbase = 1 << 1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & 1))
+        return false;
+    /* only Linux 5.9+ reports it, elsewhere the instructions fault */
+    return (getauxval(AT_HWCAP2) & hwcap2_fsgsbase) != 0;
+#else
+    return false;
+#endif
+}
+#endif
+
+static RunningMode
+get_running_mode(hermit_runtime runtime, bool uses_simd)
+{
+    static const RunningMode modes[] = {
+        [HERMIT_RUNTIME_INTERP] = Mode_Interp,
+        [HERMIT_RUNTIME_FAST_JIT] = Mode_Fast_JIT,
+        [HERMIT_RUNTIME_LLVM_JIT] = Mode_LLVM_JIT,
+        [HERMIT_RUNTIME_MULTI_TIER] = Mode_Multi_Tier_JIT,
+    };
+
+    /* the interpreters and Fast JIT have no SIMD support, an AOT image
+       doesn't care about the running mode */
+    if (uses_simd && runtime != HERMIT_RUNTIME_LLVM_JIT
+        && wasm_runtime_is_running_mode_supported(Mode_LLVM_JIT))
+    {
+        if (runtime != HERMIT_RUNTIME_DEFAULT)
+            fprintf(stderr, "hermit-base: RUNTIME can't run SIMD, using "
+                            "llvm-jit\n");
+        return Mode_LLVM_JIT;
+    }
+    if (runtime == HERMIT_RUNTIME_DEFAULT)
+        return 0;
+    if (!wasm_runtime_is_running_mode_supported(modes[runtime]))
+    {
+        fprintf(stderr, "hermit-base: RUNTIME is not supported by this build, "
+                        "using the default\n");
+        return 0;
+    }
+    return modes[runtime];
+}
+
+int wamr(const char *wasm_file, const char *aot_file, int argc, char *argv[], char *dir_list[], const uint32_t dir_list_size, char *env_list[], const uint32_t env_list_size, const char *func_name, const wamr_config *config)
 {
     int32 ret = -1;
     uint8 *wasm_file_buf = NULL;
     uint32 wasm_file_size;
-    uint32 stack_size = 64 * 1024;
-#if WASM_ENABLE_LIBC_WASI != 0
-    uint32 heap_size = 0;
-#else
-    uint32 heap_size = 16 * 1024;
-#endif
+    InstantiationArgs inst_args;
+    uint8 *heap_pool = NULL;
 #if WASM_ENABLE_FAST_JIT != 0
-    uint32 jit_code_cache_size = FAST_JIT_DEFAULT_CODE_CACHE_SIZE;
+    uint32 jit_code_cache_size = config->jit_code_cache_size
+                                     ? config->jit_code_cache_size
+                                     : FAST_JIT_DEFAULT_CODE_CACHE_SIZE;
 #endif
 #if WASM_ENABLE_JIT != 0
-    uint32 llvm_jit_size_level = 3;
-    uint32 llvm_jit_opt_level = 3;
-    uint32 segue_flags = 0;
+    uint32 llvm_jit_size_level =
+        config->llvm_jit_size_level ? config->llvm_jit_size_level : 3;
+    uint32 llvm_jit_opt_level =
+        config->llvm_jit_opt_level ? config->llvm_jit_opt_level : 3;
+    /* all of i32/i64/f32/f64/v128 loads and stores, as wamrc --enable-segue */
+    uint32 segue_flags =
+        !config->disable_segue && is_segue_supported() ? 0x1F1F : 0;
 #endif
     wasm_module_t wasm_module = NULL;
     wasm_module_inst_t wasm_module_inst = NULL;
-    RunningMode running_mode = 0;
+    RunningMode running_mode =
+        get_running_mode(config->runtime, config->uses_simd);
     RuntimeInitArgs init_args;
     char error_buf[128] = {0};
 #if WASM_ENABLE_LOG != 0
     int log_verbose_level = 2;
 #endif
-    bool is_xip_file = false;
+    module_buf_kind buf_kind = MODULE_BUF_HEAP;
+#if WASM_ENABLE_AOT != 0
+    char cache_path[PATH_MAX] = { 0 };
+    char cache_options[64];
+    bool cache_segue = false;
+#endif
 #if WASM_CONFIGUABLE_BOUNDS_CHECKS != 0
-    bool disable_bounds_checks = false;
+    bool disable_bounds_checks = config->disable_bounds_checks;
 #endif
 #if WASM_ENABLE_LIBC_WASI != 0
     const char *addr_pool[8] = {NULL};
@@ -292,22 +713,47 @@ int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[],
     int instance_port = 0;
 #endif
 #if WASM_ENABLE_STATIC_PGO != 0
-    const char *gen_prof_file = NULL;
+    const char *gen_prof_file = config->pgo_profile;
 #endif
 
     memset(&init_args, 0, sizeof(RuntimeInitArgs));
 
-    init_args.running_mode = running_mode;
-#if WASM_ENABLE_GLOBAL_HEAP_POOL != 0
-    init_args.mem_alloc_type = Alloc_With_Pool;
-    init_args.mem_alloc_option.pool.heap_buf = global_heap_buf;
-    init_args.mem_alloc_option.pool.heap_size = sizeof(global_heap_buf);
+    memset(&inst_args, 0, sizeof(InstantiationArgs));
+    inst_args.default_stack_size =
+        config->stack_size ? config->stack_size : 64 * 1024;
+#if WASM_ENABLE_LIBC_WASI != 0
+    inst_args.host_managed_heap_size = config->heap_size;
 #else
-    init_args.mem_alloc_type = Alloc_With_Allocator;
-    init_args.mem_alloc_option.allocator.malloc_func = malloc;
-    init_args.mem_alloc_option.allocator.realloc_func = realloc;
-    init_args.mem_alloc_option.allocator.free_func = free;
+    inst_args.host_managed_heap_size =
+        config->heap_size ? config->heap_size : 16 * 1024;
 #endif
+    /* 0 keeps the module's own maximum */
+    inst_args.max_memory_pages = config->max_memory_pages;
+
+    init_args.running_mode = running_mode;
+    if (config->heap_pool_size)
+    {
+        /* every runtime allocation is carved out of one mapping, pages are
+           only backed once the allocator touches them */
+        if (!(heap_pool = os_mmap(NULL, config->heap_pool_size,
+                                  MMAP_PROT_READ | MMAP_PROT_WRITE,
+                                  MMAP_MAP_NONE)))
+        {
+            fprintf(stderr, "hermit-base: failed to map the %u byte heap pool\n",
+                    config->heap_pool_size);
+            return -1;
+        }
+        init_args.mem_alloc_type = Alloc_With_Pool;
+        init_args.mem_alloc_option.pool.heap_buf = heap_pool;
+        init_args.mem_alloc_option.pool.heap_size = config->heap_pool_size;
+    }
+    else
+    {
+        init_args.mem_alloc_type = Alloc_With_Allocator;
+        init_args.mem_alloc_option.allocator.malloc_func = malloc;
+        init_args.mem_alloc_option.allocator.realloc_func = realloc;
+        init_args.mem_alloc_option.allocator.free_func = free;
+    }
 
 #if WASM_ENABLE_FAST_JIT != 0
     init_args.fast_jit_code_cache_size = jit_code_cache_size;
@@ -329,8 +775,18 @@ int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[],
     if (!wasm_runtime_full_init(&init_args))
     {
         printf("Init runtime environment failed.\n");
+        if (heap_pool)
+            os_munmap(heap_pool, config->heap_pool_size);
         return -1;
     }
+#if HERMIT_LIBC_BUILTIN != 0
+    if (!register_imported_natives(config))
+    {
+        printf("Register natives failed.\n");
+        goto fail1;
+    }
+#endif
+    hermit_trace_phase("runtime_init");
 
 #if WASM_ENABLE_LOG != 0
     bh_log_set_verbose_level(log_verbose_level);
@@ -341,49 +797,63 @@ int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[],
         native_lib_list, native_lib_count, native_handle_list);
 #endif
 
-    /* load WASM byte buffer from WASM bin file */
-    if (!(wasm_file_buf =
-              (uint8 *)bh_read_file_to_buffer(wasm_file, &wasm_file_size)))
-        goto fail1;
+#if WASM_ENABLE_MULTI_MODULE != 0
+    wasm_runtime_set_module_reader(module_reader_callback, moudle_destroyer);
+#endif
 
 #if WASM_ENABLE_AOT != 0
-    if (wasm_runtime_is_xip_file(wasm_file_buf, wasm_file_size))
+    /* prefer the precompiled image, the wasm is kept around as a fallback
+       for AOT images built for another target or WAMR version */
+    if (aot_file && config->aot_segue && !is_segue_supported())
+        fprintf(stderr,
+                "hermit-base: %s needs segue support, falling back to %s\n",
+                aot_file, wasm_file);
+    else if (aot_file && file_exists(aot_file))
     {
-        uint8 *wasm_file_mapped;
-        int map_prot = MMAP_PROT_READ | MMAP_PROT_WRITE | MMAP_PROT_EXEC;
-        int map_flags = MMAP_MAP_32BIT;
-
-        if (!(wasm_file_mapped =
-                  os_mmap(NULL, (uint32)wasm_file_size, map_prot, map_flags)))
+        if (!(wasm_module = load_module_file(aot_file, &wasm_file_buf,
+                                             &wasm_file_size, &buf_kind,
+                                             error_buf, sizeof(error_buf))))
         {
-            printf("mmap memory failed\n");
-            wasm_runtime_free(wasm_file_buf);
-            goto fail1;
+            fprintf(stderr, "hermit-base: %s: %s, falling back to %s\n",
+                    aot_file, error_buf, wasm_file);
         }
-
-        bh_memcpy_s(wasm_file_mapped, wasm_file_size, wasm_file_buf,
-                    wasm_file_size);
-        wasm_runtime_free(wasm_file_buf);
-        wasm_file_buf = wasm_file_mapped;
-        is_xip_file = true;
     }
-#endif
 
-#if WASM_ENABLE_MULTI_MODULE != 0
-    wasm_runtime_set_module_reader(module_reader_callback, moudle_destroyer);
+    /* opt-in cache of native code compiled by earlier runs */
+    if (!wasm_module && config->cache_dir && config->wasm_sha256)
+    {
+        cache_segue = !config->disable_segue && is_segue_supported();
+        get_cache_options(cache_segue, cache_options, sizeof(cache_options));
+        if (!hermit_cache_get_path(config->cache_dir, config->wasm_sha256,
+                                   cache_options, cache_path,
+                                   sizeof(cache_path)))
+            cache_path[0] = '\0';
+        else if ((wasm_module = load_module_cached(
+                      cache_path, &wasm_file_buf, &wasm_file_size)))
+            buf_kind = MODULE_BUF_CACHE;
+    }
+#else
+    (void)aot_file;
 #endif
 
-    /* load WASM module */
-    if (!(wasm_module = wasm_runtime_load(wasm_file_buf, wasm_file_size,
-                                          error_buf, sizeof(error_buf))))
+    if (!wasm_module && !(wasm_module = load_module_file(
+                              wasm_file, &wasm_file_buf, &wasm_file_size,
+                              &buf_kind, error_buf, sizeof(error_buf))))
     {
         printf("%s\n", error_buf);
-        goto fail2;
+        if (config->uses_simd
+            && !wasm_runtime_is_running_mode_supported(Mode_LLVM_JIT))
+            fprintf(stderr, "hermit-base: %s uses SIMD, which needs a hermit "
+                            "built with LLVM_DIR or packed with --aot\n",
+                    wasm_file);
+        goto fail1;
     }
 
 #if WASM_ENABLE_LIBC_WASI != 0
-    wasm_runtime_set_wasi_args(wasm_module, dir_list, dir_list_size, NULL, 0,
-                               env_list, env_list_size, argv, argc);
+    wasm_runtime_set_wasi_args(wasm_module, (const char **)dir_list,
+                               dir_list_size, NULL, 0,
+                               (const char **)env_list, env_list_size, argv,
+                               argc);
 
     wasm_runtime_set_wasi_addr_pool(wasm_module, addr_pool, addr_pool_size);
     wasm_runtime_set_wasi_ns_lookup_pool(wasm_module, ns_lookup_pool,
@@ -392,20 +862,36 @@ int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[],
 
     /* instantiate the module */
     if (!(wasm_module_inst =
-              wasm_runtime_instantiate(wasm_module, stack_size, heap_size,
-                                       error_buf, sizeof(error_buf))))
+              wasm_runtime_instantiate_ex(wasm_module, &inst_args, error_buf,
+                                          sizeof(error_buf))))
     {
         printf("%s\n", error_buf);
+#ifdef OS_ENABLE_HW_BOUND_CHECK
+        warn_address_space_limit();
+#endif
         goto fail3;
     }
+    hermit_trace_phase("instantiate");
 
 #if WASM_CONFIGUABLE_BOUNDS_CHECKS != 0
     if (disable_bounds_checks)
     {
+        /* only the interpreters check bounds per instance, JIT and AOT code
+           has the checks compiled in */
+        if (wasm_runtime_get_running_mode(wasm_module_inst) != Mode_Interp)
+            fprintf(stderr, "hermit-base: TRUSTED only applies to the "
+                            "interpreter, bounds checks stay on\n");
         wasm_runtime_set_bounds_checks(wasm_module_inst, false);
     }
+#else
+    if (config->disable_bounds_checks)
+        fprintf(stderr, "hermit-base: TRUSTED is not supported by this build\n");
 #endif
 
+    /* before the snapshot or main first touch the memory */
+    if (config->hugepages)
+        hermit_hugepages_advise(wasm_module_inst);
+
 #if WASM_ENABLE_DEBUG_INTERP != 0
     if (ip_addr != NULL)
     {
@@ -426,6 +912,22 @@ int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[],
     }
 #endif
 
+    if (config->snapshot_export)
+    {
+        if (!init_instance(wasm_module_inst, config))
+        {
+            ret = 1;
+            goto fail4;
+        }
+        hermit_trace_phase("snapshot");
+    }
+    if (config->snapshot_capture)
+    {
+        /* only the snapshot was asked for */
+        ret = 0;
+        goto fail4;
+    }
+
     ret = 0;
     if (func_name)
     {
@@ -456,15 +958,40 @@ int wamr(const char *wasm_file, int argc, char *argv[], const char *dir_list[],
         }
     }
 #endif
+    hermit_trace_phase("main");
+    hermit_stats_report(wasm_module, wasm_module_inst);
+
+#if WASM_ENABLE_JIT != 0 && WASM_ENABLE_AOT != 0
+    /* fill the cache after the guest is done so it isn't delayed by LLVM */
+    if (cache_path[0] != '\0' && buf_kind != MODULE_BUF_CACHE
+        && get_package_type(wasm_file_buf, wasm_file_size)
+               == Wasm_Module_Bytecode)
+        compile_to_cache(wasm_module, cache_path, cache_segue);
+#endif
 
 #if WASM_ENABLE_STATIC_PGO != 0 && WASM_ENABLE_AOT != 0
     if (get_package_type(wasm_file_buf, wasm_file_size) == Wasm_Module_AoT && gen_prof_file)
         dump_pgo_prof_data(wasm_module_inst, gen_prof_file);
+    else if (gen_prof_file)
+        fprintf(stderr, "hermit-base: no instrumented AOT image was run, "
+                        "not writing %s\n", gen_prof_file);
+#else
+    if (config->pgo_profile)
+        fprintf(stderr, "hermit-base: PGO_TRAIN is not supported by this build\n");
 #endif
 
-#if WASM_ENABLE_DEBUG_INTERP != 0
+    if (config->fast_exit)
+    {
+        /* the kernel drops the linear memory and every runtime structure
+           at once on exit, guest output went straight to its fds and only
+           hermit-base's own stdio may still be buffered */
+        hermit_trace_phase("teardown");
+        hermit_trace_report();
+        fflush(NULL);
+        _exit(ret);
+    }
+
 fail4:
-#endif
     /* destroy the module instance */
     wasm_runtime_deinstantiate(wasm_module_inst);
 
@@ -472,12 +999,8 @@ fail3:
     /* unload the module */
     wasm_runtime_unload(wasm_module);
 
-fail2:
     /* free the file buffer */
-    if (!is_xip_file)
-        wasm_runtime_free(wasm_file_buf);
-    else
-        os_munmap(wasm_file_buf, wasm_file_size);
+    release_module_buf(wasm_file_buf, wasm_file_size, buf_kind);
 
 fail1:
 #if BH_HAS_DLFCN
@@ -487,6 +1010,9 @@ fail1:
 
     /* destroy runtime environment */
     wasm_runtime_destroy();
+    if (heap_pool)
+        os_munmap(heap_pool, config->heap_pool_size);
+    hermit_trace_phase("teardown");
 
     return ret;
 }
@@ -4,8 +4,73 @@
  */
 
 #pragma once
+#include <stdbool.h>
 #include <stdint.h>
 
-int wamr(const char *wasm_file, int argc, char *argv[], char *dir_list[], const uint32_t dir_list_size, char *env_list[], const uint32_t env_list_size, const char *func_name);
+// Hermitfile `RUNTIME`, mirrors WAMR's RunningMode
+typedef enum
+{
+    HERMIT_RUNTIME_DEFAULT = 0,
+    HERMIT_RUNTIME_INTERP,
+    HERMIT_RUNTIME_FAST_JIT,
+    HERMIT_RUNTIME_LLVM_JIT,
+    HERMIT_RUNTIME_MULTI_TIER
+} hermit_runtime;
+
+#define HERMIT_WASM_PAGE_SIZE 65536
+#define HERMIT_WASM_MAX_PAGES 65536
+
+// engine settings from hermit.json, zero values keep WAMR's defaults
+typedef struct
+{
+    hermit_runtime runtime;
+    uint32_t jit_code_cache_size;
+    // 1-3
+    uint32_t llvm_jit_opt_level;
+    // 1-3
+    uint32_t llvm_jit_size_level;
+    // Hermitfile `STACK`, bytes of the Wasm operand and call stack
+    uint32_t stack_size;
+    // Hermitfile `HEAP`, bytes of the host managed heap of the instance
+    uint32_t heap_size;
+    // Hermitfile `MAX_MEMORY`, caps the module's maximum linear memory
+    uint32_t max_memory_pages;
+    // Hermitfile `HEAP_POOL`, bytes of the pool the runtime allocates from
+    // instead of malloc
+    uint32_t heap_pool_size;
+    // native code cache directory, NULL when caching is off
+    const char *cache_dir;
+    // hex digest of main.wasm computed by the packer, keys the cache and
+    // identifies snapshots
+    const char *wasm_sha256;
+    // Hermitfile `SNAPSHOT`, export run before main unless a snapshot of its
+    // result is packed
+    const char *snapshot_export;
+    // HERMIT_SNAPSHOT_CAPTURE, write the state after snapshot_export to this
+    // path instead of running main
+    const char *snapshot_capture;
+    // Hermitfile `TRUSTED`, skip linear memory bounds checks
+    bool disable_bounds_checks;
+    // Hermitfile `FAST_EXIT`, exit right after the guest instead of freeing
+    // the instance, module and runtime
+    bool fast_exit;
+    // Hermitfile `HUGEPAGES`, back linear memory with transparent huge pages
+    bool hugepages;
+    // HERMIT_SEGUE=0, address linear memory without GS even when supported
+    bool disable_segue;
+    // main.aot was compiled with `wamrc --enable-segue`
+    bool aot_segue;
+    // where to write the LLVM PGO profile of an instrumented main.aot, NULL
+    // unless the hermit was packed with `--pgo-train`
+    const char *pgo_profile;
+    // main.wasm has simd128 instructions, only LLVM JIT and AOT code run them
+    bool uses_simd;
+    // the modules main.wasm imports from, NULL when the packer didn't record
+    // them and a count of 0 when it has no imports
+    const char *const *import_modules;
+    uint32_t import_module_count;
+} wamr_config;
+
+int wamr(const char *wasm_file, const char *aot_file, int argc, char *argv[], char *dir_list[], const uint32_t dir_list_size, char *env_list[], const uint32_t env_list_size, const char *func_name, const wamr_config *config);
 
 bool validate_env_str(const char *env);
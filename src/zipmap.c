@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "zipmap.h"
+
+// cosmopolitan libc internal function
+char *GetProgramExecutableName(void);
+
+#define ZIP_EOCD_SIZE 22
+#define ZIP_EOCD_MAX_COMMENT 0xffff
+#define ZIP_CDIR_HEADER_SIZE 46
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_STORED 0
+#define ZIP_DEFLATED 8
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return read_u16(p) | (uint32_t)read_u16(p + 2) << 16;
+}
+
+static bool read_at(const int fd, void *buf, const size_t size, const off_t offset)
+{
+    return pread(fd, buf, size, offset) == (ssize_t)size;
+}
+
+// the executable and its central directory, opened and read once as the
+// hermit maps several entries at startup
+static struct
+{
+    bool initialized;
+    // NULL for the running executable
+    const char *path;
+    int fd;
+    off_t file_size;
+    uint8_t *cdir;
+    uint32_t cdir_size;
+    uint16_t entries;
+    // offsets are relative to the start of the zip, which follows the APE
+    off_t bias;
+} zip = {.fd = -1};
+
+static bool read_central_directory(void)
+{
+    struct stat st;
+    const char *path = zip.path != NULL ? zip.path : GetProgramExecutableName();
+    if ((zip.fd = open(path, O_RDONLY | O_CLOEXEC)) == -1 || fstat(zip.fd, &st) != 0)
+    {
+        return false;
+    }
+    zip.file_size = st.st_size;
+    // the end of central directory record is followed by at most a comment
+    const off_t tail_size = zip.file_size < ZIP_EOCD_SIZE + ZIP_EOCD_MAX_COMMENT ? zip.file_size : ZIP_EOCD_SIZE + ZIP_EOCD_MAX_COMMENT;
+    uint8_t *tail = malloc(tail_size);
+    if (tail == NULL || !read_at(zip.fd, tail, tail_size, zip.file_size - tail_size))
+    {
+        free(tail);
+        return false;
+    }
+    const uint8_t *eocd = NULL;
+    for (off_t i = tail_size - ZIP_EOCD_SIZE; i >= 0; i--)
+    {
+        if (read_u32(tail + i) == 0x06054b50)
+        {
+            eocd = tail + i;
+            break;
+        }
+    }
+    if (eocd == NULL)
+    {
+        free(tail);
+        return false;
+    }
+    const off_t eocd_offset = zip.file_size - tail_size + (eocd - tail);
+    zip.entries = read_u16(eocd + 10);
+    zip.cdir_size = read_u32(eocd + 12);
+    const uint32_t cdir_offset = read_u32(eocd + 16);
+    free(tail);
+    // zip64 archives only happen with entries over 4GiB
+    if (zip.entries == 0xffff || zip.cdir_size == 0xffffffff || cdir_offset == 0xffffffff || (off_t)zip.cdir_size > eocd_offset)
+    {
+        return false;
+    }
+    zip.bias = eocd_offset - zip.cdir_size - cdir_offset;
+    zip.cdir = malloc(zip.cdir_size);
+    return zip.cdir != NULL && read_at(zip.fd, zip.cdir, zip.cdir_size, eocd_offset - zip.cdir_size);
+}
+
+// the central directory header of an entry, NULL if there is none
+static const uint8_t *find_entry(const char *name)
+{
+    if (!zip.initialized)
+    {
+        zip.initialized = true;
+        if (!read_central_directory())
+        {
+            free(zip.cdir);
+            zip.cdir = NULL;
+        }
+    }
+    if (zip.cdir == NULL)
+    {
+        return NULL;
+    }
+    const size_t name_len = strlen(name);
+    size_t pos = 0;
+    for (uint16_t i = 0; i < zip.entries && pos + ZIP_CDIR_HEADER_SIZE <= zip.cdir_size; i++)
+    {
+        const uint8_t *header = zip.cdir + pos;
+        if (read_u32(header) != 0x02014b50)
+        {
+            return NULL;
+        }
+        const uint16_t entry_name_len = read_u16(header + 28);
+        const size_t header_size = ZIP_CDIR_HEADER_SIZE + entry_name_len + read_u16(header + 30) + read_u16(header + 32);
+        if (pos + header_size > zip.cdir_size)
+        {
+            return NULL;
+        }
+        if (entry_name_len == name_len && memcmp(header + ZIP_CDIR_HEADER_SIZE, name, name_len) == 0)
+        {
+            return header;
+        }
+        pos += header_size;
+    }
+    return NULL;
+}
+
+// finds where the data of an entry starts in the file
+static bool find_entry_data(const uint8_t *header, off_t *data_offset)
+{
+    if (read_u32(header + 20) == 0xffffffff || read_u32(header + 42) == 0xffffffff)
+    {
+        return false;
+    }
+    const off_t local_offset = zip.bias + read_u32(header + 42);
+    // the local header's extra field may differ from the central
+    // directory's, it is where the packer puts the alignment padding
+    uint8_t local[ZIP_LOCAL_HEADER_SIZE];
+    if (!read_at(zip.fd, local, sizeof(local), local_offset) || read_u32(local) != 0x04034b50)
+    {
+        return false;
+    }
+    *data_offset = local_offset + ZIP_LOCAL_HEADER_SIZE + read_u16(local + 26) + read_u16(local + 28);
+    return *data_offset + (off_t)read_u32(header + 20) <= zip.file_size;
+}
+
+// finds the data offset and size of a stored entry
+static bool find_stored_entry(const char *name, off_t *data_offset, uint32_t *data_size)
+{
+    const uint8_t *header = find_entry(name);
+    if (header == NULL || read_u16(header + 10) != ZIP_STORED || !find_entry_data(header, data_offset))
+    {
+        return false;
+    }
+    *data_size = read_u32(header + 24);
+    return true;
+}
+
+uint8_t *hermit_zip_map(const char *name, uint32_t *size, const bool code)
+{
+    off_t offset;
+    uint32_t entry_size;
+    if (!find_stored_entry(name, &offset, &entry_size) || entry_size == 0 || offset % sysconf(_SC_PAGESIZE) != 0)
+    {
+        return NULL;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_32BIT
+    if (code)
+    {
+        // as WAMR maps XIP images
+        flags |= MAP_32BIT;
+    }
+#else
+    (void)code;
+#endif
+    void *buf = mmap(NULL, entry_size, PROT_READ | PROT_WRITE, flags, zip.fd, offset);
+    if (buf == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = entry_size;
+    return buf;
+}
+
+void hermit_zip_unmap(uint8_t *buf, const uint32_t size)
+{
+    munmap(buf, size);
+}
+
+bool hermit_zip_has(const char *name)
+{
+    return find_entry(name) != NULL;
+}
+
+uint8_t *hermit_zip_read(const char *name, uint32_t *size)
+{
+    const uint8_t *header = find_entry(name);
+    off_t offset;
+    if (header == NULL || !find_entry_data(header, &offset))
+    {
+        return NULL;
+    }
+    const uint16_t method = read_u16(header + 10);
+    const uint32_t compressed_size = read_u32(header + 20);
+    const uint32_t entry_size = read_u32(header + 24);
+    if ((method != ZIP_STORED && method != ZIP_DEFLATED) || (method == ZIP_STORED && compressed_size != entry_size))
+    {
+        return NULL;
+    }
+    uint8_t *buf = malloc((size_t)entry_size + 1);
+    uint8_t *data = method == ZIP_STORED ? buf : malloc((size_t)compressed_size + 1);
+    bool ok = buf != NULL && data != NULL && read_at(zip.fd, data, compressed_size, offset);
+    if (ok && method == ZIP_DEFLATED)
+    {
+        // raw deflate, the zip headers take the place of zlib's
+        z_stream stream = {.next_in = data, .avail_in = compressed_size, .next_out = buf, .avail_out = entry_size};
+        ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        if (ok)
+        {
+            ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == entry_size;
+            inflateEnd(&stream);
+        }
+    }
+    if (data != buf)
+    {
+        free(data);
+    }
+    if (!ok)
+    {
+        free(buf);
+        return NULL;
+    }
+    *size = entry_size;
+    return buf;
+}
+
+void hermit_zip_use(const char *path)
+{
+    zip.path = path;
+}
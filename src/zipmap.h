@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2023 Dylibso.  All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// maps an uncompressed, page aligned entry of the hermit's own zip straight
+// from the executable, private and writable so loaders can patch it in place
+// while untouched pages stay shared with the page cache. NULL if the entry is
+// missing, compressed or unaligned, callers then read it through /zip/.
+// code entries are placed where WAMR expects code, never executable: callers
+// mprotect them read and execute once they are patched.
+uint8_t *hermit_zip_map(const char *name, uint32_t *size, const bool code);
+
+void hermit_zip_unmap(uint8_t *buf, const uint32_t size);
+
+// true if the hermit's zip has the entry, however it is stored. Unlike
+// access() on /zip/, it follows hermit_zip_use.
+bool hermit_zip_has(const char *name);
+
+// a malloc'd copy of a stored or deflated entry, for the small entries that
+// aren't mapped. NULL if it is missing or can't be read.
+uint8_t *hermit_zip_read(const char *name, uint32_t *size);
+
+// maps and reads entries of another hermit instead of the running
+// executable, must be called before the first hermit_zip_map
+void hermit_zip_use(const char *path);